@@ -0,0 +1,241 @@
+//
+//  benchmark.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "utils.h"
+#include "frame-parser.h"
+#include "scanner.h"
+#include "codec.h"
+
+#define BENCH_BUFFER_SIZE 4096
+#define BENCH_MIN_BYTES (64 * 1024 * 1024)   // per variant and size
+
+typedef const uint8_t *(*scan_func_t) (const uint8_t *p, const uint8_t *end);
+
+typedef uint16_t (*crc_func_t) (uint16_t crc, const uint8_t *buff, int len);
+
+static const struct
+{
+    const char *name;
+    crc_func_t func;
+} crc_variants[] =
+{
+    { "bitwise", crc16_bitwise },
+    { "table", crc16_table },
+    { "slice8", crc16_slice8 },
+    { NULL, NULL }
+};
+
+static const int crc_sizes[] = { 22, 122, 1024, BENCH_BUFFER_SIZE, 0 };
+
+//  @brief Time the CRC-16 engines over several buffer sizes; the sizes cover
+//      the default low latency frame, the largest frame and bulk data.
+
+void
+bench_crc (void)
+{
+    static uint8_t buff[BENCH_BUFFER_SIZE];
+    volatile uint16_t sink = 0;
+    
+    srand (1);
+    for (int i = 0; i < sizeof (buff); i++)
+    {
+        buff[i] = (uint8_t) rand ();
+    }
+    
+    fprintf (stdout, "CRC-16 engines (bytes/ns):\n%-10s", "size");
+    for (int v = 0; crc_variants[v].name; v++)
+    {
+        fprintf (stdout, "%10s", crc_variants[v].name);
+    }
+    fprintf (stdout, "\n");
+    
+    for (int s = 0; crc_sizes[s]; s++)
+    {
+        int size = crc_sizes[s];
+        long rounds = BENCH_MIN_BYTES / size;
+        
+        fprintf (stdout, "%-10d", size);
+        for (int v = 0; crc_variants[v].name; v++)
+        {
+            uint16_t crc = 0;
+            // the slow reference engine gets fewer rounds
+            long n = (crc_variants[v].func == crc16_bitwise) ? rounds / 8 : rounds;
+            
+            uint64_t start = monotonic_ns ();
+            for (long r = 0; r < n; r++)
+            {
+                crc = crc_variants[v].func (crc, buff, size);
+            }
+            uint64_t elapsed = monotonic_ns () - start;
+            sink ^= crc;
+            
+            fprintf (stdout, "%10.3f", (double) n * size / (elapsed ? elapsed : 1));
+        }
+        fprintf (stdout, "\n");
+    }
+    (void) sink;
+}
+
+//  @brief Time the delimiter scanners over a 4 KB buffer holding no special
+//      byte (a long payload or idle run) and over one with a special byte
+//      every 32 bytes on average.
+
+void
+bench_scan (void)
+{
+    static uint8_t buff[BENCH_BUFFER_SIZE];
+    static const struct
+    {
+        const char *name;
+        scan_func_t func;
+    } variants[] =
+    {
+        { "bytewise", scan_special_bytewise },
+        { "scalar", scan_special_scalar },
+        { "best", scan_special },
+        { NULL, NULL }
+    };
+    uintptr_t sink = 0;
+    
+    fprintf (stdout, "Delimiter scanners (bytes/ns):\n%-10s", "density");
+    for (int v = 0; variants[v].name; v++)
+    {
+        fprintf (stdout, "%10s", variants[v].name);
+    }
+    fprintf (stdout, "\n");
+    
+    for (int sparse = 0; sparse < 2; sparse++)
+    {
+        srand (1);
+        for (int i = 0; i < sizeof (buff); i++)
+        {
+            buff[i] = (uint8_t) (rand () % 0xf0);
+            if (sparse && (rand () % 32) == 0)
+            {
+                buff[i] = 0xf0 + rand () % 4;
+            }
+        }
+        
+        fprintf (stdout, "%-10s", sparse ? "1/32" : "none");
+        for (int v = 0; variants[v].name; v++)
+        {
+            long rounds = BENCH_MIN_BYTES / sizeof (buff);
+            
+            uint64_t start = monotonic_ns ();
+            for (long r = 0; r < rounds; r++)
+            {
+                const uint8_t *p = buff;
+                while ((p = variants[v].func (p, buff + sizeof (buff))) < buff + sizeof (buff))
+                {
+                    sink += *p++;
+                }
+            }
+            uint64_t elapsed = monotonic_ns () - start;
+            
+            fprintf (stdout, "%10.3f", (double) rounds * sizeof (buff) / (elapsed ? elapsed : 1));
+        }
+        fprintf (stdout, "\n");
+    }
+    if (sink == 1)
+    {
+        fprintf (stdout, "\n");   // keep the loops from being optimized away
+    }
+}
+
+//  @brief Time the escape/unescape codec against the byte by byte reference
+//      on 120 bytes frames (the largest low latency frame) filled with the
+//      0x55 pattern, random bytes and 0xf0 only (the worst case).
+
+void
+bench_codec (void)
+{
+    static uint8_t frames[3][120];
+    static uint8_t escaped[2 * sizeof (frames[0])];
+    static uint8_t out[2 * sizeof (frames[0])];
+    static const char *names[] = { "0x55", "random", "0xf0" };
+    long rounds = BENCH_MIN_BYTES / sizeof (frames[0]);
+    volatile size_t sink = 0;
+    
+    srand (1);
+    for (int i = 0; i < sizeof (frames[0]); i++)
+    {
+        frames[0][i] = 0x55;
+        frames[1][i] = (uint8_t) rand ();
+        frames[2][i] = SOF_CHAR;
+    }
+    
+    fprintf (stdout, "Escape codec, %lu bytes frames (bytes/ns):\n", sizeof (frames[0]));
+    fprintf (stdout, "%-10s%10s%10s%10s%10s\n", "payload", "esc ref", "esc", "unesc ref", "unesc");
+    
+    for (int f = 0; f < 3; f++)
+    {
+        size_t len = codec_escape (escaped, sizeof (escaped), frames[f], sizeof (frames[f]));
+        uint64_t start, elapsed[4];
+        
+        start = monotonic_ns ();
+        for (long r = 0; r < rounds; r++)
+        {
+            sink += codec_escape_bytewise (out, sizeof (out), frames[f], sizeof (frames[f]));
+        }
+        elapsed[0] = monotonic_ns () - start;
+        
+        start = monotonic_ns ();
+        for (long r = 0; r < rounds; r++)
+        {
+            sink += codec_escape (out, sizeof (out), frames[f], sizeof (frames[f]));
+        }
+        elapsed[1] = monotonic_ns () - start;
+        
+        start = monotonic_ns ();
+        for (long r = 0; r < rounds; r++)
+        {
+            sink += codec_unescape_bytewise (out, escaped, len);
+        }
+        elapsed[2] = monotonic_ns () - start;
+        
+        start = monotonic_ns ();
+        for (long r = 0; r < rounds; r++)
+        {
+            sink += codec_unescape (out, escaped, len);
+        }
+        elapsed[3] = monotonic_ns () - start;
+        
+        fprintf (stdout, "%-10s", names[f]);
+        for (int i = 0; i < 4; i++)
+        {
+            fprintf (stdout, "%10.3f", (double) rounds * sizeof (frames[f]) / (elapsed[i] ? elapsed[i] : 1));
+        }
+        fprintf (stdout, "\n");
+    }
+}
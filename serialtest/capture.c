@@ -0,0 +1,418 @@
+//
+//  capture.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "capture.h"
+#include "port.h"
+
+#define CAPTURE_DEBUG 0
+
+capture_t *g_capture;
+
+
+//  @brief Write a whole buffer, retrying on short writes.
+//  @retval 0 if successful, -1 otherwise.
+
+static int
+write_all (int fd, const uint8_t *buff, size_t len)
+{
+    ssize_t res;
+    
+    while (len > 0)
+    {
+        if ((res = write (fd, buff, len)) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buff += res;
+        len -= res;
+    }
+    return 0;
+}
+
+//  @brief Writer thread: saves the full halves, and the partially filled one
+//      every CAPTURE_FLUSH_MS, so a quiet line still reaches the file.
+
+static void *
+capture_writer (void *p)
+{
+    capture_t *c = (capture_t *) p;
+    struct timespec ts;
+    struct timeval tv;
+    int half;
+    size_t len;
+    bool expired = false;
+    
+    pthread_mutex_lock (&c->lock);
+    while (true)
+    {
+        if (c->pending < 0)
+        {
+            if (c->used[c->active] > 0 && (expired || !c->running))
+            {
+                c->pending = c->active;
+                c->active ^= 1;
+            }
+            else if (!c->running)
+            {
+                break;
+            }
+            else
+            {
+                gettimeofday (&tv, NULL);
+                ts.tv_sec = tv.tv_sec + CAPTURE_FLUSH_MS / 1000;
+                ts.tv_nsec = tv.tv_usec * 1000 + (CAPTURE_FLUSH_MS % 1000) * 1000000L;
+                if (ts.tv_nsec >= 1000000000)
+                {
+                    ts.tv_sec++;
+                    ts.tv_nsec -= 1000000000;
+                }
+                expired = pthread_cond_timedwait (&c->cond, &c->lock, &ts) == ETIMEDOUT;
+                continue;
+            }
+        }
+        half = c->pending;
+        len = c->used[half];
+        pthread_mutex_unlock (&c->lock);
+        
+        if (write_all (c->fd, c->buffer[half], len) < 0)
+        {
+            perror ("capture write");
+        }
+#if CAPTURE_DEBUG == 1
+        fprintf (stdout, "capture: saved %zu bytes\n", len);
+#endif
+        
+        pthread_mutex_lock (&c->lock);
+        c->saved += len;
+        c->used[half] = 0;
+        c->pending = -1;
+        expired = false;
+    }
+    pthread_mutex_unlock (&c->lock);
+    
+    return NULL;
+}
+
+static void
+capture_append (capture_t *c, const capture_hdr_t *hdr, const uint8_t *data, size_t len, uint64_t when);
+
+//  @brief Create a capture file and start its writer thread.
+//  @param path: file name; an existing file is overwritten.
+//  @retval the capture, or NULL on errors.
+
+capture_t *
+capture_open (const char *path)
+{
+    capture_t *c;
+    pcap_file_hdr_t hdr;
+    capture_hdr_t clock_hdr;
+    struct timespec rt, mt;
+    
+    if ((c = calloc (1, sizeof (capture_t))) == NULL)
+    {
+        return NULL;
+    }
+    c->buffer[0] = malloc (CAPTURE_BUFFER_SIZE);
+    c->buffer[1] = malloc (CAPTURE_BUFFER_SIZE);
+    if (c->buffer[0] == NULL || c->buffer[1] == NULL)
+    {
+        free (c->buffer[0]);
+        free (c->buffer[1]);
+        free (c);
+        return NULL;
+    }
+    // touch every page now, not on the first records
+    memset (c->buffer[0], 0, CAPTURE_BUFFER_SIZE);
+    memset (c->buffer[1], 0, CAPTURE_BUFFER_SIZE);
+    
+    if ((c->fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+        perror (path);
+        free (c->buffer[0]);
+        free (c->buffer[1]);
+        free (c);
+        return NULL;
+    }
+    
+    hdr.magic = CAPTURE_MAGIC;
+    hdr.version_major = 2;
+    hdr.version_minor = 4;
+    hdr.thiszone = 0;
+    hdr.sigfigs = 0;
+    hdr.snaplen = CAPTURE_SNAPLEN;
+    hdr.linktype = CAPTURE_LINKTYPE;
+    if (write_all (c->fd, (uint8_t *) &hdr, sizeof (hdr)) < 0)
+    {
+        perror (path);
+        close (c->fd);
+        free (c->buffer[0]);
+        free (c->buffer[1]);
+        free (c);
+        return NULL;
+    }
+    c->saved = sizeof (hdr);
+    
+    // records are stamped with the monotonic clock, the file wants wall time
+    clock_gettime (CLOCK_REALTIME, &rt);
+    clock_gettime (CLOCK_MONOTONIC, &mt);
+    c->realtime_offset = ((int64_t) rt.tv_sec - mt.tv_sec) * 1000000000 + (rt.tv_nsec - mt.tv_nsec);
+    
+    c->pending = -1;
+    c->running = true;
+    pthread_mutex_init (&c->lock, NULL);
+    pthread_cond_init (&c->cond, NULL);
+    
+    clock_hdr.direction = CAPTURE_CLOCK;
+    clock_hdr.port = clock_hdr.mode = clock_hdr.address = 0;
+    capture_append (c, &clock_hdr, (uint8_t *) &c->realtime_offset, sizeof (c->realtime_offset),
+                    (uint64_t) ((int64_t) mt.tv_sec * 1000000000 + mt.tv_nsec));
+    if (pthread_create (&c->writer, NULL, capture_writer, c))
+    {
+        close (c->fd);
+        free (c->buffer[0]);
+        free (c->buffer[1]);
+        free (c);
+        return NULL;
+    }
+    return c;
+}
+
+//  @brief Save what is left and close the file. The buffers are released,
+//      the capture_t itself is not: a thread that fetched it just before
+//      the close still finds it, stopped, and does nothing.
+
+void
+capture_close (capture_t *c)
+{
+    if (c == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock (&c->lock);
+    if (!c->running)
+    {
+        pthread_mutex_unlock (&c->lock);
+        return;
+    }
+    c->running = false;
+    pthread_cond_signal (&c->cond);
+    pthread_mutex_unlock (&c->lock);
+    
+    pthread_join (c->writer, NULL);
+    close (c->fd);
+    free (c->buffer[0]);
+    free (c->buffer[1]);
+    c->buffer[0] = c->buffer[1] = NULL;
+}
+
+// Append a record; never blocks on the file.
+static void
+capture_append (capture_t *c, const capture_hdr_t *hdr, const uint8_t *data, size_t len, uint64_t when)
+{
+    pcap_rec_hdr_t rec;
+    size_t incl = len;
+    uint64_t ts;
+    uint8_t *p;
+    
+    if (incl > CAPTURE_SNAPLEN - sizeof (capture_hdr_t))
+    {
+        incl = CAPTURE_SNAPLEN - sizeof (capture_hdr_t);
+    }
+    ts = when + c->realtime_offset;
+    rec.ts_sec = (uint32_t) (ts / 1000000000);
+    rec.ts_nsec = (uint32_t) (ts % 1000000000);
+    rec.incl_len = (uint32_t) (incl + sizeof (capture_hdr_t));
+    rec.orig_len = (uint32_t) (len + sizeof (capture_hdr_t));
+    
+    pthread_mutex_lock (&c->lock);
+    if (!c->running || c->paused)
+    {
+        pthread_mutex_unlock (&c->lock);
+        return;
+    }
+    if (c->used[c->active] + sizeof (rec) + rec.incl_len > CAPTURE_BUFFER_SIZE)
+    {
+        if (c->pending >= 0)
+        {
+            // the disk is behind, better a hole in the capture than a stall
+            c->dropped++;
+            pthread_mutex_unlock (&c->lock);
+            return;
+        }
+        c->pending = c->active;
+        c->active ^= 1;
+        pthread_cond_signal (&c->cond);
+    }
+    p = c->buffer[c->active] + c->used[c->active];
+    memcpy (p, &rec, sizeof (rec));
+    memcpy (p + sizeof (rec), hdr, sizeof (capture_hdr_t));
+    memcpy (p + sizeof (rec) + sizeof (capture_hdr_t), data, incl);
+    c->used[c->active] += sizeof (rec) + rec.incl_len;
+    c->records++;
+    c->bytes += len;
+    pthread_mutex_unlock (&c->lock);
+}
+
+//  @brief Append a chunk to the capture; never blocks on the file.
+//  @param c: capture.
+//  @param dir: received, transmitted or command.
+//  @param port: the port it went through.
+//  @param data: the bytes, as read or written.
+//  @param len: their number; longer chunks are truncated to the snap length.
+//  @param when: CLOCK_MONOTONIC time of the read or write, ns.
+
+void
+capture_write (capture_t *c, capture_dir_t dir, const port_t *port, const uint8_t *data, size_t len, uint64_t when)
+{
+    capture_hdr_t hdr;
+    
+    hdr.direction = (uint8_t) dir;
+    hdr.port = (uint8_t) port->id;
+    hdr.mode = (uint8_t) __atomic_load_n (&port->mode, __ATOMIC_RELAXED);
+    hdr.address = port->address;
+    capture_append (c, &hdr, data, len, when);
+}
+
+//  @brief Map a capture file for reading.
+//  @param r: reader.
+//  @param path: file name.
+//  @retval 0 if successful, -1 if the file can't be read or is no pcap file
+//      of ours.
+
+int
+capture_reader_open (capture_reader_t *r, const char *path)
+{
+    const pcap_file_hdr_t *hdr;
+    struct stat st;
+    void *base;
+    int fd;
+    
+    if ((fd = open (path, O_RDONLY)) < 0)
+    {
+        perror (path);
+        return -1;
+    }
+    if (fstat (fd, &st) < 0 || st.st_size < (off_t) sizeof (pcap_file_hdr_t))
+    {
+        fprintf (stdout, "%s: not a capture file\n", path);
+        close (fd);
+        return -1;
+    }
+    base = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
+    {
+        perror (path);
+        return -1;
+    }
+    
+    hdr = base;
+    if ((hdr->magic != CAPTURE_MAGIC && hdr->magic != CAPTURE_MAGIC_US) ||
+        hdr->linktype != CAPTURE_LINKTYPE)
+    {
+        fprintf (stdout, "%s: not a capture file\n", path);
+        munmap (base, st.st_size);
+        return -1;
+    }
+    madvise (base, st.st_size, MADV_SEQUENTIAL);
+    
+    r->base = base;
+    r->size = st.st_size;
+    r->p = r->base + sizeof (pcap_file_hdr_t);
+    r->end = r->base + r->size;
+    r->ns_factor = hdr->magic == CAPTURE_MAGIC ? 1 : 1000;
+    r->realtime_offset = 0;
+    return 0;
+}
+
+//  @brief Get the next chunk; clock records are taken care of here.
+//  @param r: reader.
+//  @param rec: the record is returned here; its data points into the file.
+//  @retval 1 if a record was returned, 0 at the end of the file, -1 if the
+//      file is damaged (a truncated last record is taken as the end).
+
+int
+capture_read (capture_reader_t *r, capture_record_t *rec)
+{
+    pcap_rec_hdr_t prh;
+    capture_hdr_t hdr;
+    int64_t offset;
+    
+    while (r->p + sizeof (prh) <= r->end)
+    {
+        memcpy (&prh, r->p, sizeof (prh));
+        if (prh.incl_len < sizeof (hdr) || prh.incl_len > CAPTURE_SNAPLEN)
+        {
+            return -1;
+        }
+        if (r->p + sizeof (prh) + prh.incl_len > r->end)
+        {
+            return 0;
+        }
+        memcpy (&hdr, r->p + sizeof (prh), sizeof (hdr));
+        rec->data = r->p + sizeof (prh) + sizeof (hdr);
+        rec->len = prh.incl_len - sizeof (hdr);
+        r->p += sizeof (prh) + prh.incl_len;
+        
+        if (hdr.direction == CAPTURE_CLOCK && rec->len == sizeof (offset))
+        {
+            memcpy (&offset, rec->data, sizeof (offset));
+            r->realtime_offset = offset;
+            continue;
+        }
+        rec->direction = hdr.direction;
+        rec->port = hdr.port;
+        rec->mode = hdr.mode;
+        rec->address = hdr.address;
+        rec->when = (uint64_t) prh.ts_sec * 1000000000 + (uint64_t) prh.ts_nsec * r->ns_factor
+                    - r->realtime_offset;
+        return 1;
+    }
+    return 0;
+}
+
+//  @brief Unmap a capture file.
+
+void
+capture_reader_close (capture_reader_t *r)
+{
+    munmap ((void *) r->base, r->size);
+}
@@ -0,0 +1,156 @@
+//
+//  capture.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef capture_h
+#define capture_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "utils.h"
+
+// Captures are classic pcap files with nanosecond timestamps and a user
+// link type (DLT_USER0, select the "user DLTs" dissector in Wireshark).
+// Each record holds one chunk exactly as read from, or written to, a port,
+// prefixed by a capture_hdr_t. The first record of a file is a
+// CAPTURE_CLOCK one, carrying the CLOCK_REALTIME - CLOCK_MONOTONIC offset,
+// so a replay can restore the monotonic arrival times the frame
+// timestamps are compared against.
+#define CAPTURE_MAGIC 0xa1b23c4d    // pcap, nanosecond resolution
+#define CAPTURE_MAGIC_US 0xa1b2c3d4 // pcap, microsecond resolution
+#define CAPTURE_LINKTYPE 147        // LINKTYPE_USER0
+#define CAPTURE_SNAPLEN 65535
+#define CAPTURE_BUFFER_SIZE (1024 * 1024)   // each of the two halves
+#define CAPTURE_FLUSH_MS 500        // longest time a record stays in memory
+
+typedef enum
+{
+    CAPTURE_RX = 0,
+    CAPTURE_TX,
+    CAPTURE_TX_CMD,     // written with the CMD/DATA line in command state
+    CAPTURE_CLOCK,      // int64_t clock offset, ns
+} capture_dir_t;
+
+typedef struct __attribute__ ((packed))
+{
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+} pcap_file_hdr_t;
+
+typedef struct __attribute__ ((packed))
+{
+    uint32_t ts_sec;
+    uint32_t ts_nsec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+} pcap_rec_hdr_t;
+
+// pseudo header in front of every chunk
+typedef struct __attribute__ ((packed))
+{
+    uint8_t direction;  // capture_dir_t
+    uint8_t port;       // port id
+    uint8_t mode;       // op_mode_t of the port at the time
+    uint8_t address;    // own address of the port
+} capture_hdr_t;
+
+// a record, as returned by capture_read()
+typedef struct
+{
+    capture_dir_t direction;
+    int port;
+    op_mode_t mode;
+    uint8_t address;
+    uint64_t when;      // CLOCK_MONOTONIC of the recording machine, ns
+    const uint8_t *data;
+    size_t len;
+} capture_record_t;
+
+// Sequential reader; the whole file is mapped, records are not copied.
+typedef struct
+{
+    const uint8_t *base;
+    const uint8_t *p;
+    const uint8_t *end;
+    size_t size;
+    uint32_t ns_factor;     // 1 for nanosecond files, 1000 for microsecond ones
+    int64_t realtime_offset;
+} capture_reader_t;
+
+// The RX and sender threads append records to one half of a preallocated
+// double buffer, under a lock held only for the copy; a writer thread
+// saves the other half to the file. When both halves are full the record
+// is dropped and counted, the threads being captured never wait for disk.
+typedef struct
+{
+    int fd;
+    uint8_t *buffer[2];
+    size_t used[2];
+    int active;             // half being filled
+    int pending;            // half being saved, -1 if none
+    bool running;
+    bool paused;
+    int64_t realtime_offset;    // CLOCK_REALTIME - CLOCK_MONOTONIC, ns
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t dropped;
+    uint64_t saved;         // bytes in the file
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t writer;
+} capture_t;
+
+extern capture_t *g_capture;
+
+capture_t *
+capture_open (const char *path);
+
+void
+capture_close (capture_t *c);
+
+struct port_;
+
+void
+capture_write (capture_t *c, capture_dir_t dir, const struct port_ *port, const uint8_t *data, size_t len, uint64_t when);
+
+int
+capture_reader_open (capture_reader_t *r, const char *path);
+
+int
+capture_read (capture_reader_t *r, capture_record_t *rec);
+
+void
+capture_reader_close (capture_reader_t *r);
+
+#endif /* capture_h */
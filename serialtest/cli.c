@@ -29,11 +29,18 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <sys/termios.h>
 
 #include "utils.h"
 #include "frame-parser.h"
 #include "statistics.h"
+#include "port.h"
+#include "benchmark.h"
+#include "capture.h"
+#include "saturation.h"
+#include "ping.h"
+#include "stats-series.h"
 #include "cli.h"
 
 
@@ -50,9 +57,6 @@ typedef struct
 } cmds_t;
 
 
-extern ipc_t ipc;
-extern pthread_mutex_t send_serial_mutex;
-
 extern void
 quit (void);
 
@@ -71,6 +75,9 @@ interval_cmd (int argc, char *argv[]);
 static int
 len_cmd (int argc, char *argv[]);
 
+static int
+burst_cmd (int argc, char *argv[]);
+
 static int
 ser_cfg (int argc, char *argv[]);
 
@@ -86,6 +93,24 @@ help (int argc, char *argv[]);
 static int
 spy_cmd (int argc, char *argv[]);
 
+static int
+bench_cmd (int argc, char *argv[]);
+
+static int
+port_cmd (int argc, char *argv[]);
+
+static int
+capture_cmd (int argc, char *argv[]);
+
+static int
+sat_cmd (int argc, char *argv[]);
+
+static int
+ping_cmd (int argc, char *argv[]);
+
+static int
+series_cmd (int argc, char *argv[]);
+
 
 //===============================================================================
 // Commands table.
@@ -98,10 +123,17 @@ const cmds_t rxcmds[] =
     { "send", send_cmd, "Send various types of frames over the serial port" },
     { "interval", interval_cmd, "Set the interval between low latency frames" },
     { "len", len_cmd, "Set the length of the low latency frames" },
+    { "burst", burst_cmd, "Set the number of frames sent at each interval" },
     { "set", set_cmd, "Set various parameters" },
     { "stat", stats_cmd, "Show/clear statistics" },
     { "spy", spy_cmd, "Spy on the current radio channel" },
     { "sercfg", ser_cfg, "Configure the serial port" },
+    { "bench", bench_cmd, "Run the built-in micro-benchmarks" },
+    { "port", port_cmd, "List the ports or select the one commands go to" },
+    { "capture", capture_cmd, "Capture the serial traffic to a pcap file" },
+    { "sat", sat_cmd, "Ramp up the load to find the link capacity" },
+    { "ping", ping_cmd, "Measure round trip times, or answer pings" },
+    { "series", series_cmd, "Record the statistics interval by interval" },
     { "quit", quit_cmd, "Quit program" },
     { "exit", quit_cmd, "Exit program" },
     { "help", help, "Show this help; for individual command help, use <command> -h" },
@@ -206,11 +238,18 @@ dump_rec (int argc, char *argv[])
     return OK;
 }
 
+// Hand a command to the sender thread of the current port.
+static void
+post_command (ipc_t *msg)
+{
+    port_post (port_current (), msg);
+}
+
 // Command to send various types of frames over the serial port.
 static int
 send_cmd (int argc, char *argv[])
 {
-    static char tmp_buff[256];
+    ipc_t msg = { .cmd = NOP };
     char *p;
     
     if (argc > 0)
@@ -218,26 +257,23 @@ send_cmd (int argc, char *argv[])
         if (!strcasecmp (argv[0], "off"))
         {
             // stop sending low latency frames
-            pthread_mutex_lock (&send_serial_mutex);
-            ipc.cmd = STOP_LOW_LATENCY_FRAMES;
-            pthread_mutex_unlock (&send_serial_mutex);
+            msg.cmd = STOP_LOW_LATENCY_FRAMES;
+            post_command (&msg);
         }
         else if (!strcasecmp (argv[0], "ll") && (argc > 1))
         {
             // send low latency frames
-            pthread_mutex_lock (&send_serial_mutex);
-            ipc.address = atoi (argv[1]);
-            ipc.cmd =  SEND_LOW_LATENCY_FRAMES;
-            pthread_mutex_unlock (&send_serial_mutex);
+            msg.address = atoi (argv[1]);
+            msg.cmd =  SEND_LOW_LATENCY_FRAMES;
+            post_command (&msg);
         }
         else if (!strcasecmp (argv[0], "llh") && (argc > 2))
         {
             // send ll frames with header
-            pthread_mutex_lock (&send_serial_mutex);
-            ipc.address = atoi (argv[1]);
-            ipc.cmd = SEND_LOW_LATENCY_FRAMES_WITH_HEADER;
-            ipc.parameter0 = atoi (argv[2]);
-            pthread_mutex_unlock (&send_serial_mutex);
+            msg.address = atoi (argv[1]);
+            msg.cmd = SEND_LOW_LATENCY_FRAMES_WITH_HEADER;
+            msg.parameter0 = atoi (argv[2]);
+            post_command (&msg);
         }
         else if (!strcasecmp (argv[0], "plain") && (argc > 1))
         {
@@ -245,13 +281,13 @@ send_cmd (int argc, char *argv[])
             int cnt = 0;
             for (p = argv[1]; *p; p++)
             {
-                if (cnt > sizeof (tmp_buff))
+                if (cnt >= sizeof (msg.text))
                 {
                     break;
                 }
                 if (*p != '\\')
                 {
-                    tmp_buff[cnt++] = *p;
+                    msg.text[cnt++] = *p;
                 }
                 else
                 {
@@ -259,28 +295,26 @@ send_cmd (int argc, char *argv[])
                     switch (*p)
                     {
                         case 'r':
-                            tmp_buff[cnt++] = 0xd;
+                            msg.text[cnt++] = 0xd;
                             break;
                             
                         case 'n':
-                            tmp_buff[cnt++] = 0xa;
+                            msg.text[cnt++] = 0xa;
                             break;
                             
                         case '\\':
-                            tmp_buff[cnt++] = '\\';
+                            msg.text[cnt++] = '\\';
                             break;
 
                         default:
-                            tmp_buff[cnt++] = *p;
+                            msg.text[cnt++] = *p;
                             break;
                     }
                 }
             }
-            pthread_mutex_lock (&send_serial_mutex);
-            ipc.text = tmp_buff;
-            ipc.parameter0 = cnt;
-            ipc.cmd =  SEND_PLAIN_FRAME;
-            pthread_mutex_unlock (&send_serial_mutex);
+            msg.parameter0 = cnt;
+            msg.cmd =  SEND_PLAIN_FRAME;
+            post_command (&msg);
         }
         else
         {
@@ -303,43 +337,55 @@ send_cmd (int argc, char *argv[])
 static int
 spy_cmd (int argc, char *argv[])
 {
-    pthread_mutex_lock (&send_serial_mutex);
-
+    ipc_t msg = { .cmd = NOP };
+    
     if (argc > 0 && !strcasecmp (argv[0], "red"))
     {
-        ipc.cmd = GET_RED_TRAFFIC_STATS;
+        msg.cmd = GET_RED_TRAFFIC_STATS;
     }
     else
     {
-        ipc.cmd = GET_TRAFFIC_STATS;
+        msg.cmd = GET_TRAFFIC_STATS;
     }
-    pthread_mutex_unlock (&send_serial_mutex);
+    post_command (&msg);
 
     return OK;
 }
 
-// Set the interval between low latency frames.
+// Set the interval between low latency frames, in ms (default) or us.
 static int
 interval_cmd (int argc, char *argv[])
 {
+    ipc_t msg = { .cmd = NOP };
+    
     if (argc > 0)
     {
-        int value = atoi (argv[0]);
-        if (value > 0 && value <= 100)
+        char *unit;
+        long value = strtol (argv[0], &unit, 10);
+        
+        if (*unit == '\0' || !strcasecmp (unit, "ms"))
+        {
+            value *= 1000;
+        }
+        else if (strcasecmp (unit, "us"))
         {
-            pthread_mutex_lock (&send_serial_mutex);
-            ipc.cmd = INTERVAL;
-            ipc.parameter0 = value;
-            pthread_mutex_unlock (&send_serial_mutex);
+            value = 0;
+        }
+        if (value >= TX_PERIOD_MIN_US && value <= TX_PERIOD_MAX_US)
+        {
+            msg.cmd = INTERVAL;
+            msg.parameter0 = (uint32_t) value;
+            post_command (&msg);
         }
         else
         {
-            fprintf (stdout, "Invalid parameter, should be between 1 and 100 (ms)\n");
+            fprintf (stdout, "Invalid parameter, should be between %d us and %d ms\n",
+                     TX_PERIOD_MIN_US, TX_PERIOD_MAX_US / 1000);
         }
     }
     else
     {
-        fprintf (stdout, "Usage:\tinterval <nn>\n");
+        fprintf (stdout, "Usage:\tinterval <nn>[ms|us]\n");
     }
     
     return OK;
@@ -349,15 +395,16 @@ interval_cmd (int argc, char *argv[])
 static int
 len_cmd (int argc, char *argv[])
 {
+    ipc_t msg = { .cmd = NOP };
+    
     if (argc > 0)
     {
         int value = atoi (argv[0]);
         if (value > 0 && value <= 120)  // max 120 bytes payoad
         {
-            pthread_mutex_lock (&send_serial_mutex);
-            ipc.cmd = LENGTH;
-            ipc.parameter0 = value;
-            pthread_mutex_unlock (&send_serial_mutex);
+            msg.cmd = LENGTH;
+            msg.parameter0 = value;
+            post_command (&msg);
         }
         else
         {
@@ -372,12 +419,40 @@ len_cmd (int argc, char *argv[])
     return OK;
 }
 
+// Set the number of low latency frames sent back to back at each interval.
+static int
+burst_cmd (int argc, char *argv[])
+{
+    ipc_t msg = { .cmd = NOP };
+    
+    if (argc > 0)
+    {
+        int value = atoi (argv[0]);
+        if (value > 0 && value <= MAX_BURST)
+        {
+            msg.cmd = BURST;
+            msg.parameter0 = value;
+            post_command (&msg);
+        }
+        else
+        {
+            fprintf (stdout, "Invalid parameter, should be between 1 and %d (frames)\n", MAX_BURST);
+        }
+    }
+    else
+    {
+        fprintf (stdout, "Usage:\tburst <nn>\n");
+    }
+    
+    return OK;
+}
+
 // Configure serial port parameters.
 static int
 ser_cfg (int argc, char *argv[])
 {
     struct termios options;
-    int fd = get_serial_fd();
+    int fd = port_current ()->fd;
     
     if (argc > 0)
     {
@@ -492,13 +567,14 @@ set_cmd (int argc, char *argv[])
 {
     struct timespec sts;
     int region = 0;
+    ipc_t msg;
     
     if (argc > 1)
     {
         int rounds = 0;
         do
         {
-            pthread_mutex_lock (&send_serial_mutex);
+            msg.cmd = NOP;
             if (!strcasecmp (argv[0], "zch"))
             {
                 if (argc == 3)
@@ -514,8 +590,8 @@ set_cmd (int argc, char *argv[])
                 }
                 else
                 {
-                    ipc.cmd = SET_CHANNEL;
-                    ipc.parameter0 = ch - 11;
+                    msg.cmd = SET_CHANNEL;
+                    msg.parameter0 = ch - 11;
                 }
                 sts.tv_nsec = 20000000;
                 sts.tv_sec = 0;
@@ -523,40 +599,40 @@ set_cmd (int argc, char *argv[])
             }
             else  if (!strcasecmp (argv[0], "master"))
             {
-                ipc.cmd = SET_MASTER;
+                msg.cmd = SET_MASTER;
                 if (!strcasecmp (argv[1], "on"))
                 {
-                    ipc.parameter0 = 0;
+                    msg.parameter0 = 0;
                 }
                 else if (!strcasecmp (argv[1], "off"))
                 {
-                    ipc.parameter0 = 1;
+                    msg.parameter0 = 1;
                 }
                 else
                 {
-                    ipc.cmd = NOP;
+                    msg.cmd = NOP;
                     fprintf (stdout, "Invalid parameter (on or off accepted)\n");
                 }
             }
             else if (!strcasecmp (argv[0], "rate"))
             {
-                ipc.cmd = SET_RATE;
+                msg.cmd = SET_RATE;
                 
                 if (!strcasecmp (argv[1], "250K"))
                 {
-                    ipc.parameter0 = MOD_OQPSK_250K;
+                    msg.parameter0 = MOD_OQPSK_250K;
                 }
                 else if (!strcasecmp (argv[1], "1M"))
                 {
-                    ipc.parameter0 = MOD_GFSK_1M;
+                    msg.parameter0 = MOD_GFSK_1M;
                 }
                 else if (!strcasecmp (argv[1], "2M"))
                 {
-                    ipc.parameter0 = MOD_GFSK_2M;
+                    msg.parameter0 = MOD_GFSK_2M;
                 }
                 else
                 {
-                    ipc.cmd = NOP;
+                    msg.cmd = NOP;
                     fprintf (stdout, "Invalid data rate; valid values are 250K, 1M and 2M\n");
                 }
             }
@@ -580,8 +656,8 @@ set_cmd (int argc, char *argv[])
                 }
                 if (region < 20)
                 {
-                    ipc.cmd = SET_REGION;
-                    ipc.parameter0 = region;
+                    msg.cmd = SET_REGION;
+                    msg.parameter0 = region;
                 }
                 else
                 {
@@ -595,10 +671,10 @@ set_cmd (int argc, char *argv[])
             {
                 if (argc == 4)
                 {
-                    ipc.cmd = SET_HOP_PARAMS;
-                    ipc.parameter0 = atoi (argv[1]);
-                    ipc.parameter1 = atoi (argv[2]);
-                    ipc.parameter2 = atoi (argv[3]);
+                    msg.cmd = SET_HOP_PARAMS;
+                    msg.parameter0 = atoi (argv[1]);
+                    msg.parameter1 = atoi (argv[2]);
+                    msg.parameter2 = atoi (argv[3]);
                 }
                 else
                 {
@@ -609,8 +685,8 @@ set_cmd (int argc, char *argv[])
             {
                 if (argc == 2)
                 {
-                    ipc.cmd = SET_HOP_STRETCHING;
-                    ipc.parameter0 = atoi (argv[1]);
+                    msg.cmd = SET_HOP_STRETCHING;
+                    msg.parameter0 = atoi (argv[1]);
                 }
                 else
                 {
@@ -621,8 +697,8 @@ set_cmd (int argc, char *argv[])
             {
                 if (argc == 2)
                 {
-                    ipc.cmd = SET_BAUD;
-                    ipc.parameter0 = atoi (argv[1]);
+                    msg.cmd = SET_BAUD;
+                    msg.parameter0 = atoi (argv[1]);
                 }
                 else
                 {
@@ -634,8 +710,8 @@ set_cmd (int argc, char *argv[])
                 int param = atoi (argv[1]);
                 if (param < 4)
                 {
-                    ipc.parameter0 = param;
-                    ipc.cmd = SET_PROTOCOL;
+                    msg.parameter0 = param;
+                    msg.cmd = SET_PROTOCOL;
                 }
                 else
                 {
@@ -645,7 +721,7 @@ set_cmd (int argc, char *argv[])
             else if (!strcasecmp (argv[0], "slot"))
             {
                 int slot, i;
-                ipc.parameter0 = 0;
+                msg.parameter0 = 0;
                 for (i = 1; i < argc; i++)
                 {
                     slot = atoi (argv[i]);
@@ -654,11 +730,11 @@ set_cmd (int argc, char *argv[])
                         fprintf (stdout, "<slot#> can be from 0 to 4\n");
                         break;
                     }
-                    ipc.parameter0 |= (1 << slot);
+                    msg.parameter0 |= (1 << slot);
                 }
                 if (i == argc)
                 {
-                    ipc.cmd = SET_SLOT;
+                    msg.cmd = SET_SLOT;
                 }
             }
             else if (!strcasecmp (argv[0], "bw"))
@@ -689,8 +765,8 @@ set_cmd (int argc, char *argv[])
                     }
                     else
                     {
-                        ipc.parameter0 = bw + ((which << 4) & 0x70);
-                        ipc.cmd = SET_BW;
+                        msg.parameter0 = bw + ((which << 4) & 0x70);
+                        msg.cmd = SET_BW;
                     }
                 }
                 else
@@ -699,51 +775,512 @@ set_cmd (int argc, char *argv[])
                     fprintf (stdout, "<slot#> 0 to 4; <bw>: 250K, 1M, 2M\n");
                 }
             }
+            else if (!strcasecmp (argv[0], "ts"))
+            {
+                int bits = atoi (argv[1]);
+                if (bits == 32 || bits == 64)
+                {
+                    ext_header (SET_PARAMETER, bits == 64);
+                }
+                else
+                {
+                    fprintf (stdout, "Invalid parameter (32 or 64 accepted)\n");
+                }
+            }
             else
             {
                 fprintf (stdout, "Invalid parameter\n");
             }
-            pthread_mutex_unlock (&send_serial_mutex);
+            if (msg.cmd != NOP)
+            {
+                post_command (&msg);
+            }
         }
         while (rounds--);
     }
     else
     {
-        fprintf (stdout, "Usage:\tset { zch | master | rate | hop | stretch | region | baud | proto | bw | slot }\n");
+        fprintf (stdout, "Usage:\tset { zch | master | rate | hop | stretch | region | baud | proto | bw | slot | ts }\n");
     }
      
     return OK;
 }
 
 
+// Print the latency percentiles of a histogram.
+static void
+print_percentiles (const char *label, const histogram_t *h)
+{
+    fprintf (stdout, "%s latency p50/p90/p99/p99.9/max (ms): %.2f/%.2f/%.2f/%.2f/%.2f (%llu samples)\n",
+             label,
+             hist_percentile (h, 50) / 1000.0, hist_percentile (h, 90) / 1000.0,
+             hist_percentile (h, 99) / 1000.0, hist_percentile (h, 99.9) / 1000.0,
+             h->max / 1000.0, (unsigned long long) h->total);
+}
+
+// Print the statistics of a table, node by node.
+static void
+print_stats (const stats_table_t *table)
+{
+    static histogram_t all;
+    int nodes = 0;
+    
+    for (int i = 0; i < STATS_NODES; i++)
+    {
+        const statistics_t *ps = &table->node[i];
+        
+        if (ps->frames_recvd)
+        {
+            int lost = frames_lost (ps);
+            
+            fprintf (stdout, "Node %d: avg rssi: %d dBm, total frames %d, lost frames %d (%.2f%%), "
+                     "late/reordered %d, duplicates %d\n"
+                     "Average/min/max latency (ms): %.2f/%.2f/%.2f\n",
+                     i, ps->rssi_sum  / ps->rssi_samples,
+                     ps->frames_recvd + lost, lost,
+                     lost * 100.0 / (ps->frames_recvd + lost),
+                     ps->frames_late, ps->frames_dup,
+                     (ps->latency_sum / (ps->latency_samples) / 1000.0),
+                     ps->latency_min / 1000.0, ps->latency_max / 1000.0);
+            fprintf (stdout, "Frames with CRC errors %u (%.2f%% from total frames received)\n",
+                     table->crc_error_count, table->crc_error_count * 100.0 / table->total_recvd_frames);
+        }
+        if (ps->latency_hist.total)
+        {
+            char label[16];
+            
+            snprintf (label, sizeof (label), "Node %d", i);
+            print_percentiles (label, &ps->latency_hist);
+            nodes++;
+        }
+        if (ps->clock.valid)
+        {
+            fprintf (stdout, "Node %d clock: offset %+.3f ms, drift %+.2f ppm, best round trip %.3f ms "
+                     "(%u exchanges); latencies corrected\n",
+                     i, ps->clock.offset / 1e6, ps->clock.drift * 1e6, ps->clock.delay / 1e6,
+                     ps->clock.count);
+        }
+    }
+    if (nodes > 1)
+    {
+        latency_summary (table, &all);
+        print_percentiles ("All nodes", &all);
+    }
+}
+
+// Print the ping statistics of a port, originator and responder side.
+static void
+print_ping_stats (const port_t *port)
+{
+    static ping_tx_stats_t tx;
+    static ping_rx_stats_t rx;
+    
+    ping_snapshot (&port->ping, &tx, &rx);
+    if (tx.sent)
+    {
+        fprintf (stdout, "Ping: %llu sent, %llu answered, %llu lost, %llu in flight, "
+                 "%llu late, %llu duplicates, %llu unmatched\n",
+                 (unsigned long long) tx.sent, (unsigned long long) rx.answered,
+                 (unsigned long long) tx.lost, (unsigned long long) ping_in_flight (&tx, &rx),
+                 (unsigned long long) rx.late, (unsigned long long) rx.duplicates,
+                 (unsigned long long) rx.unmatched);
+    }
+    if (rx.rtt.total)
+    {
+        print_percentiles ("Ping round trip", &rx.rtt);
+    }
+    if (rx.echoed || rx.echo_dropped)
+    {
+        fprintf (stdout, "Responder: %llu pings echoed, %llu dropped; turnaround p50/p99/max (us): %u/%u/%u\n",
+                 (unsigned long long) rx.echoed, (unsigned long long) rx.echo_dropped,
+                 hist_percentile (&tx.turnaround, 50), hist_percentile (&tx.turnaround, 99),
+                 tx.turnaround.max);
+    }
+}
+
+// Print the transmit side statistics of a port.
+static void
+print_tx_stats (const port_t *port)
+{
+    static tx_sched_stats_t sched;
+    static tx_track_stats_t track;
+    tx_stats_t tx;
+    
+    port_tx_snapshot (port, &tx);
+    tx_sched_snapshot (&port->sched, &sched);
+    tx_track_snapshot (&port->track, &track);
+    if (tx.last > tx.first)
+    {
+        double seconds = (tx.last - tx.first) / 1e9;
+        double line_rate = port->baudrate / 10.0;   // bytes/s, 8N1
+        fprintf (stdout, "TX: %llu frames, %llu bytes in %.2f s: %.0f frames/s, %.0f bytes/s, "
+                 "%.1f%% of %d baud; %llu drain waits\n",
+                 (unsigned long long) tx.frames, (unsigned long long) tx.bytes, seconds,
+                 tx.frames / seconds, tx.bytes / seconds,
+                 tx.bytes / seconds * 100.0 / line_rate, port->baudrate,
+                 (unsigned long long) tx.stalls);
+    }
+    if (track.serialization.total)
+    {
+        const histogram_t *serialization = &track.serialization;
+        fprintf (stdout, "TX serialization per frame p50/p99/max (us): %.1f/%.1f/%.1f, %u in flight\n",
+                 hist_percentile (serialization, 50) / 1000.0, hist_percentile (serialization, 99) / 1000.0,
+                 serialization->max / 1000.0, track.in_flight);
+    }
+    if (sched.fired)
+    {
+        const histogram_t *jitter = &sched.jitter;
+        fprintf (stdout, "TX: period %.3f ms, %llu deadlines, %llu missed; "
+                 "jitter p50/p99/p99.9/max (us): %.1f/%.1f/%.1f/%.1f\n",
+                 port->sched.period / 1e6,
+                 (unsigned long long) sched.fired, (unsigned long long) sched.missed,
+                 hist_percentile (jitter, 50) / 1000.0, hist_percentile (jitter, 99) / 1000.0,
+                 hist_percentile (jitter, 99.9) / 1000.0, jitter->max / 1000.0);
+    }
+    if (sched.cmd_latency.total)
+    {
+        const histogram_t *latency = &sched.cmd_latency;
+        fprintf (stdout, "Commands: %llu; issue to wire p50/p99/max (us): %.1f/%.1f/%.1f\n",
+                 (unsigned long long) latency->total,
+                 hist_percentile (latency, 50) / 1000.0, hist_percentile (latency, 99) / 1000.0,
+                 latency->max / 1000.0);
+    }
+}
+
 // Statistics related commands.
 static int
 stats_cmd (int argc, char *argv[])
 {
+    static stats_table_t total, copy;
+    port_t *port = port_current ();
+    
     if (argc > 0)
     {
         if (!strcasecmp (argv[0], "clear"))
         {
-            clear_stats();
+            for (int i = 0; i < g_port_count; i++)
+            {
+                port_stats_clear (g_ports[i]);
+            }
+        }
+        else if (!strcasecmp (argv[0], "all"))
+        {
+            // aggregate view: one line per port, then the merged nodes
+            clear_stats (&total);
+            for (int i = 0; i < g_port_count; i++)
+            {
+                tx_stats_t tx;
+                
+                stats_snapshot (&g_ports[i]->stats, &copy);
+                port_tx_snapshot (g_ports[i], &tx);
+                fprintf (stdout, "Port %d (%s): %u frames received, %u with CRC errors, %llu sent\n",
+                         i, g_ports[i]->path, copy.total_recvd_frames, copy.crc_error_count,
+                         (unsigned long long) tx.frames);
+                merge_stats (&total, &copy);
+            }
+            print_stats (&total);
+        }
+        else if (!strcasecmp (argv[0], "save") && argc > 1)
+        {
+            stats_snapshot (&port->stats, &copy);
+            if (save_latency (&copy, argv[1]) < 0)
+            {
+                fprintf (stdout, "Failed to write %s\n", argv[1]);
+            }
+        }
+        else if (!strcasecmp (argv[0], "load") && argc > 1)
+        {
+            // loaded aside, then merged by the RX thread
+            clear_stats (&copy);
+            int count = load_latency (&copy, argv[1]);
+            if (count < 0)
+            {
+                fprintf (stdout, "Failed to read %s\n", argv[1]);
+            }
+            else
+            {
+                port_stats_request (port, STATS_MERGE, &copy);
+                fprintf (stdout, "Merged %d latency histograms\n", count);
+            }
+        }
+        else
+        {
+            fprintf (stdout, "Usage:\tstat [ clear | all | save <file> | load <file> ]\n");
         }
     }
     else
     {
-        for (int i = 0; i < 255; i++)
+        stats_snapshot (&port->stats, &copy);
+        print_stats (&copy);
+        print_tx_stats (port);
+        print_ping_stats (port);
+    }
+    
+    return OK;
+}
+
+// List the ports, or select the one the commands go to.
+static int
+port_cmd (int argc, char *argv[])
+{
+    if (argc > 0)
+    {
+        if (!strcasecmp (argv[0], "-h"))
+        {
+            fprintf (stdout, "Usage:\tport [ <n> ]\n");
+        }
+        else if (port_select (atoi (argv[0])) < 0)
         {
-            if (g_stats[i].frames_recvd)
+            fprintf (stdout, "Invalid port, should be between 0 and %d\n", g_port_count - 1);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < g_port_count; i++)
+        {
+            port_t *port = g_ports[i];
+            fprintf (stdout, "%c %d: %s, address %d, protocol %d, cpu %d, %u frames received\n",
+                     port == port_current () ? '*' : ' ', i, port->path, port->address,
+                     port->mode, port->cpu, __atomic_load_n (&port->stats.total_recvd_frames, __ATOMIC_RELAXED));
+        }
+    }
+    
+    return OK;
+}
+
+// Start, stop or show the traffic capture.
+static int
+capture_cmd (int argc, char *argv[])
+{
+    capture_t *cap = __atomic_load_n (&g_capture, __ATOMIC_ACQUIRE);
+    
+    if (argc > 0)
+    {
+        if (!strcasecmp (argv[0], "-h"))
+        {
+            fprintf (stdout, "Usage:\tcapture [ <file> | off | pause | resume ]\n");
+        }
+        else if (!strcasecmp (argv[0], "off"))
+        {
+            __atomic_store_n (&g_capture, NULL, __ATOMIC_RELEASE);
+            capture_close (cap);
+        }
+        else if (!strcasecmp (argv[0], "pause") || !strcasecmp (argv[0], "resume"))
+        {
+            if (cap)
             {
-                fprintf (stdout, "Node %d: avg rssi: %d dBm, total frames %d, lost frames %d (%.2f%%)\n"
-                         "Average/min/max latency (ms): %.2f/%.2f/%.2f\n",
-                         i, g_stats[i].rssi_sum  / g_stats[i].rssi_samples,
-                         g_stats[i].frames_recvd + g_stats[i].frames_lost, g_stats[i].frames_lost,
-                         g_stats[i].frames_lost * 100.0 / (g_stats[i].frames_recvd + g_stats[i].frames_lost),
-                         (g_stats[i].latency_sum / (g_stats[i].latency_samples) / 1000.0),
-                         g_stats[i].latency_min / 1000.0, g_stats[i].latency_max / 1000.0);
-                fprintf (stdout, "Frames with CRC errors %u (%.2f%% from total frames received)\n",
-                         g_crc_error_count, g_crc_error_count * 100.0 / g_total_recvd_frames);
+                __atomic_store_n (&cap->paused, !strcasecmp (argv[0], "pause"), __ATOMIC_RELAXED);
             }
         }
+        else if (cap)
+        {
+            fprintf (stdout, "A capture is running, stop it first\n");
+        }
+        else if ((cap = capture_open (argv[0])) == NULL)
+        {
+            fprintf (stdout, "Could not start the capture\n");
+        }
+        else
+        {
+            __atomic_store_n (&g_capture, cap, __ATOMIC_RELEASE);
+        }
+    }
+    else if (cap)
+    {
+        pthread_mutex_lock (&cap->lock);
+        fprintf (stdout, "capture%s: %llu records, %llu bytes captured, %llu bytes saved, %llu records dropped\n",
+                 cap->paused ? " (paused)" : "",
+                 (unsigned long long) cap->records, (unsigned long long) cap->bytes,
+                 (unsigned long long) cap->saved, (unsigned long long) cap->dropped);
+        pthread_mutex_unlock (&cap->lock);
+    }
+    else
+    {
+        fprintf (stdout, "No capture running\n");
+    }
+    
+    return OK;
+}
+
+// Start, stop, show or save the time series of all the ports.
+static int
+series_cmd (int argc, char *argv[])
+{
+    if (argc > 0 && !strcasecmp (argv[0], "on"))
+    {
+        uint32_t interval_ms = argc > 1 ? atoi (argv[1]) : SERIES_INTERVAL_MS;
+        
+        for (int i = 0; i < g_port_count; i++)
+        {
+            series_start (g_ports[i]->series, interval_ms);
+        }
+    }
+    else if (argc > 0 && !strcasecmp (argv[0], "off"))
+    {
+        for (int i = 0; i < g_port_count; i++)
+        {
+            series_stop (g_ports[i]->series);
+        }
+    }
+    else if (argc > 1 && !strcasecmp (argv[0], "save"))
+    {
+        series_format_t format = argc > 2 && !strcasecmp (argv[2], "bin") ? SERIES_BINARY : SERIES_CSV;
+        FILE *fp;
+        int res, count = 0;
+        
+        if ((fp = fopen (argv[1], format == SERIES_BINARY ? "wb" : "w")) == NULL)
+        {
+            fprintf (stdout, "Could not open %s\n", argv[1]);
+            return OK;
+        }
+        res = series_save_header (fp, format);
+        for (int i = 0; i < g_port_count && res >= 0; i++)
+        {
+            if ((res = series_save (g_ports[i]->series, fp, format)) > 0)
+            {
+                count += res;
+            }
+        }
+        if (fclose (fp) || res < 0)
+        {
+            fprintf (stdout, "Failed to save the time series to %s\n", argv[1]);
+        }
+        else
+        {
+            fprintf (stdout, "%d samples saved to %s\n", count, argv[1]);
+        }
+    }
+    else if (argc > 0)
+    {
+        fprintf (stdout, "Usage:\tseries [ on [<interval ms>] | off | save <file> [csv|bin] ]\n"
+                 "\tone sample per node and interval, the last %d of each port kept\n", SERIES_DEPTH);
+    }
+    else
+    {
+        for (int i = 0; i < g_port_count; i++)
+        {
+            const stats_series_t *ps = g_ports[i]->series;
+            uint64_t head = __atomic_load_n (&ps->head, __ATOMIC_ACQUIRE);
+            
+            fprintf (stdout, "Port %d: series %s, interval %u ms, %llu samples taken, %llu kept\n",
+                     i, __atomic_load_n (&ps->enabled, __ATOMIC_RELAXED) ? "on" : "off",
+                     __atomic_load_n (&ps->interval_ms, __ATOMIC_RELAXED),
+                     (unsigned long long) head,
+                     (unsigned long long) (head < SERIES_DEPTH ? head : SERIES_DEPTH));
+            if (__atomic_load_n (&ps->untracked, __ATOMIC_RELAXED))
+            {
+                fprintf (stdout, "\t%u nodes not followed, only %d are per port\n",
+                         __atomic_load_n (&ps->untracked, __ATOMIC_RELAXED), SERIES_NODES);
+            }
+        }
+    }
+    
+    return OK;
+}
+
+// Send pings at the current interval and length, or switch the responder.
+static int
+ping_cmd (int argc, char *argv[])
+{
+    ipc_t msg = { .cmd = NOP };
+    port_t *port = port_current ();
+    
+    if (argc > 1 && !strcasecmp (argv[0], "respond"))
+    {
+        __atomic_store_n (&port->responder, !strcasecmp (argv[1], "on"), __ATOMIC_RELAXED);
+    }
+    else if (argc > 0 && !strcasecmp (argv[0], "off"))
+    {
+        msg.cmd = STOP_LOW_LATENCY_FRAMES;
+        post_command (&msg);
+    }
+    else if (argc > 0 && isdigit ((unsigned char) argv[0][0]))
+    {
+        msg.cmd = SEND_PING_FRAMES;
+        msg.address = atoi (argv[0]);
+        post_command (&msg);
+    }
+    else
+    {
+        fprintf (stdout, "Usage:\tping <address> | off | respond on|off\n"
+                 "\tpings go out at the low latency interval; see stat for the RTTs\n");
+    }
+    
+    return OK;
+}
+
+// Link saturation test: find the highest sustainable frame rate.
+static int
+sat_cmd (int argc, char *argv[])
+{
+    port_t *rx = port_current ();
+    int frame_len = 22;
+    uint32_t step_ms = SAT_DEFAULT_STEP_MS;
+    
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcasecmp (argv[i], "len") && i + 1 < argc)
+        {
+            frame_len = atoi (argv[++i]);
+        }
+        else if (!strcasecmp (argv[i], "rx") && i + 1 < argc)
+        {
+            int id = atoi (argv[++i]);
+            rx = (id >= 0 && id < g_port_count) ? g_ports[id] : NULL;
+        }
+        else if (!strcasecmp (argv[i], "step") && i + 1 < argc)
+        {
+            step_ms = atoi (argv[++i]);
+        }
+        else
+        {
+            frame_len = 0;
+        }
+    }
+    
+    if (frame_len < (int) sizeof (frame_hdr_t) + 1 || frame_len > 120 || rx == NULL || step_ms < 100)
+    {
+        fprintf (stdout, "Usage:\tsat [ len <bytes> ] [ rx <port> ] [ step <ms> ]\n"
+                 "\tlen: frame length, 10 to 120, default 22; rx: receiving port, default\n"
+                 "\tthe current one (loopback or echo); step: time per load step, >= 100 ms\n");
+    }
+    else
+    {
+        saturation_run (port_current (), rx, frame_len, step_ms);
+    }
+    
+    return OK;
+}
+
+// Run the built-in micro-benchmarks.
+static int
+bench_cmd (int argc, char *argv[])
+{
+    if (argc > 0 && !strcasecmp (argv[0], "-h"))
+    {
+        fprintf (stdout, "Usage:\tbench [ crc | scan | codec ]\n");
+    }
+    else if (argc == 0)
+    {
+        bench_crc ();
+        bench_scan ();
+        bench_codec ();
+    }
+    else if (!strcasecmp (argv[0], "crc"))
+    {
+        bench_crc ();
+    }
+    else if (!strcasecmp (argv[0], "scan"))
+    {
+        bench_scan ();
+    }
+    else if (!strcasecmp (argv[0], "codec"))
+    {
+        bench_codec ();
+    }
+    else
+    {
+        fprintf (stdout, "Invalid parameter\n");
     }
     
     return OK;
@@ -0,0 +1,130 @@
+//
+//  clock-sync.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "clock-sync.h"
+
+
+//  @brief Forget all about a peer's clock.
+
+void
+clock_est_reset (clock_est_t *c)
+{
+    memset (c, 0, sizeof (clock_est_t));
+}
+
+// Fit a line through the offset history: the offset at its centre of
+// gravity, and the slope as the drift. Computed relative to the first
+// point, so the doubles keep their precision.
+static void
+clock_est_fit (clock_est_t *c)
+{
+    unsigned n = c->points < CLOCK_HISTORY ? c->points : CLOCK_HISTORY;
+    uint64_t t0 = c->history[0].when;
+    int64_t o0 = c->history[0].offset;
+    double mt = 0, mo = 0, stt = 0, sto = 0;
+    
+    for (unsigned i = 0; i < n; i++)
+    {
+        mt += (double) (int64_t) (c->history[i].when - t0);
+        mo += (double) (c->history[i].offset - o0);
+    }
+    mt /= n;
+    mo /= n;
+    for (unsigned i = 0; i < n; i++)
+    {
+        double dt = (double) (int64_t) (c->history[i].when - t0) - mt;
+        stt += dt * dt;
+        sto += dt * ((double) (c->history[i].offset - o0) - mo);
+    }
+    c->drift = (n >= CLOCK_FIT_MIN && stt > 0) ? sto / stt : 0;
+    c->offset = o0 + (int64_t) mo;
+    c->epoch = t0 + (int64_t) mt;
+    c->valid = true;
+}
+
+//  @brief Add the timestamps of one exchange.
+//  @param c: estimate of the peer's clock.
+//  @param t1: ping sent, local clock, ns.
+//  @param t2: ping received by the peer, its clock.
+//  @param t3: pong sent by the peer, its clock.
+//  @param t4: pong received, local clock.
+
+void
+clock_est_sample (clock_est_t *c, uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4)
+{
+    int64_t rtt = (int64_t) (t4 - t1) - (int64_t) (t3 - t2);
+    unsigned n;
+    
+    if (t4 < t1 || t3 < t2 || rtt < 0)
+    {
+        return;     // can't be a real exchange
+    }
+    if (c->count == 0 || (uint64_t) rtt < c->best.delay)
+    {
+        c->best.offset = ((int64_t) (t2 - t1) + (int64_t) (t3 - t4)) / 2;
+        c->best.delay = (uint64_t) rtt;
+        c->best.when = t4;
+    }
+    if (c->count++ == 0)
+    {
+        c->period = t4;
+    }
+    if (t4 - c->period < CLOCK_SPACING_NS && c->points > 0)
+    {
+        return;     // the first sample is used at once, for a quick start
+    }
+    
+    n = c->points % CLOCK_HISTORY;
+    c->history[n].offset = c->best.offset;
+    c->history[n].when = c->best.when;
+    c->points++;
+    c->delay = c->best.delay;
+    c->best.delay = UINT64_MAX;
+    c->period = t4;
+    clock_est_fit (c);
+}
+
+//  @brief Peer clock offset at a given local time.
+//  @param c: estimate of the peer's clock.
+//  @param local: local time (CLOCK_MONOTONIC, ns).
+//  @param offset: peer - local, in ns, returned here.
+//  @retval false if there is no estimate yet.
+
+bool
+clock_est_offset (const clock_est_t *c, uint64_t local, int64_t *offset)
+{
+    if (!c->valid)
+    {
+        return false;
+    }
+    *offset = c->offset + (int64_t) (c->drift * ((double) local - (double) c->epoch));
+    return true;
+}
@@ -0,0 +1,79 @@
+//
+//  clock-sync.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef clock_sync_h
+#define clock_sync_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CLOCK_HISTORY 32            // filtered offsets the fit is made on
+#define CLOCK_SPACING_NS 1000000000ULL  // at least this far apart
+#define CLOCK_FIT_MIN 4             // offsets needed before trusting a drift
+
+// Estimate of a peer's clock against ours, NTP fashion: each ping/pong
+// exchange gives t1 (ping sent, our clock), t2 (ping received, peer's
+// clock), t3 (pong sent, peer's clock) and t4 (pong received, our clock),
+// hence an offset ((t2 - t1) + (t3 - t4)) / 2 and a round trip delay
+// (t4 - t1) - (t3 - t2). Of the samples of each CLOCK_SPACING_NS, the one
+// with the lowest delay (the least queueing, so the least asymmetry) is
+// kept; a least squares line through the last CLOCK_HISTORY offsets kept
+// gives the offset and the drift.
+typedef struct
+{
+    struct
+    {
+        int64_t offset;     // ns, peer - local
+        uint64_t delay;     // ns
+        uint64_t when;      // t4
+    } best;                 // best sample of the current period
+    struct
+    {
+        int64_t offset;
+        uint64_t when;
+    } history[CLOCK_HISTORY];
+    unsigned count;         // samples taken
+    unsigned points;        // history entries
+    uint64_t period;        // start of the current period
+    int64_t offset;         // estimate at epoch, ns
+    double drift;           // ns per ns, positive if the peer runs faster
+    uint64_t epoch;         // local time of the estimate
+    uint64_t delay;         // of the last sample kept
+    bool valid;
+} clock_est_t;
+
+void
+clock_est_reset (clock_est_t *c);
+
+void
+clock_est_sample (clock_est_t *c, uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4);
+
+bool
+clock_est_offset (const clock_est_t *c, uint64_t local, int64_t *offset);
+
+#endif /* clock_sync_h */
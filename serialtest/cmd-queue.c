@@ -0,0 +1,107 @@
+//
+//  cmd-queue.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "cmd-queue.h"
+
+
+//  @brief Initialize an empty command queue.
+
+void
+cmd_queue_init (cmd_queue_t *q)
+{
+    for (size_t i = 0; i < CMD_QUEUE_SIZE; i++)
+    {
+        q->slot[i].seq = i;
+    }
+    q->head = 0;
+    q->tail = 0;
+}
+
+//  @brief Queue a command; safe to call from any number of threads.
+//  @param q: command queue.
+//  @param msg: command, copied into the queue.
+//  @retval true if queued, false if the queue is full.
+
+bool
+cmd_queue_push (cmd_queue_t *q, const ipc_t *msg)
+{
+    size_t pos = __atomic_load_n (&q->head, __ATOMIC_RELAXED);
+    cmd_slot_t *slot;
+    
+    while (true)
+    {
+        slot = &q->slot[pos & (CMD_QUEUE_SIZE - 1)];
+        intptr_t diff = (intptr_t) __atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE) - (intptr_t) pos;
+        if (diff == 0)
+        {
+            // the slot is free, try to claim it
+            if (__atomic_compare_exchange_n (&q->head, &pos, pos + 1, true,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+            // pos was reloaded by the failed exchange
+        }
+        else if (diff < 0)
+        {
+            return false;   // still held by the consumer, one lap behind
+        }
+        else
+        {
+            pos = __atomic_load_n (&q->head, __ATOMIC_RELAXED);
+        }
+    }
+    
+    memcpy (&slot->msg, msg, sizeof (ipc_t));
+    __atomic_store_n (&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+//  @brief Take the oldest command out of the queue; single consumer only.
+//  @param q: command queue.
+//  @param msg: the command is returned here.
+//  @retval true if a command was returned, false if the queue is empty.
+
+bool
+cmd_queue_pop (cmd_queue_t *q, ipc_t *msg)
+{
+    size_t pos = q->tail;
+    cmd_slot_t *slot = &q->slot[pos & (CMD_QUEUE_SIZE - 1)];
+    
+    if (__atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+    {
+        return false;
+    }
+    memcpy (msg, &slot->msg, sizeof (ipc_t));
+    __atomic_store_n (&slot->seq, pos + CMD_QUEUE_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n (&q->tail, pos + 1, __ATOMIC_RELAXED);
+    return true;
+}
@@ -0,0 +1,66 @@
+//
+//  cmd-queue.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef cmd_queue_h
+#define cmd_queue_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "frame-parser.h"
+
+#define CMD_QUEUE_SIZE 64   // power of two
+
+// Bounded lock-free queue of commands, many producers (the CLI, scripts) and
+// a single consumer (the sender thread). Messages are copied in and out, so
+// each slot owns its payload. Every slot carries a sequence number telling
+// whose turn it is: pos when free for the producer claiming position pos,
+// pos + 1 once filled for the consumer.
+typedef struct
+{
+    size_t seq;
+    ipc_t msg;
+} cmd_slot_t;
+
+typedef struct
+{
+    cmd_slot_t slot[CMD_QUEUE_SIZE];
+    size_t head __attribute__ ((aligned (64)));     // next position to claim
+    size_t tail __attribute__ ((aligned (64)));     // written by the consumer only
+} cmd_queue_t;
+
+void
+cmd_queue_init (cmd_queue_t *q);
+
+bool
+cmd_queue_push (cmd_queue_t *q, const ipc_t *msg);
+
+bool
+cmd_queue_pop (cmd_queue_t *q, ipc_t *msg);
+
+#endif /* cmd_queue_h */
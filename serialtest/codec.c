@@ -0,0 +1,193 @@
+//
+//  codec.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "codec.h"
+#include "scanner.h"
+#include "frame-parser.h"
+
+
+//  @brief Escape a frame body for the 0xf0/0xf1 framing: 0xf0, 0xf1 and
+//      0xf2 become 0xf2 followed by 0, 1 and 2 respectively. Runs of
+//      ordinary bytes are located with the block scanner and copied whole.
+//  @param dst: output buffer.
+//  @param dst_len: size of the output buffer; the input is truncated at the
+//      first byte that doesn't fit.
+//  @param src: frame body.
+//  @param len: length of the frame body.
+//  @retval number of bytes written to dst.
+
+size_t
+codec_escape (uint8_t *dst, size_t dst_len, const uint8_t *src, size_t len)
+{
+    const uint8_t *end = src + len;
+    uint8_t *q = dst;
+    uint8_t *q_end = dst + dst_len;
+    
+    while (src < end)
+    {
+        const uint8_t *p = scan_special (src, end);
+        size_t run = p - src;
+        
+        if (run > (size_t) (q_end - q))
+        {
+            run = q_end - q;
+            memcpy (q, src, run);
+            return q + run - dst;
+        }
+        memcpy (q, src, run);
+        q += run;
+        src = p;
+        
+        // special bytes tend to come in bursts, handle them here
+        while (src < end && IS_SPECIAL (*src))
+        {
+            uint8_t c = *src++;
+            if (c == SOH_CHAR)
+            {
+                if (q == q_end)
+                {
+                    return q - dst;
+                }
+                *q++ = c;  // no need to escape it
+            }
+            else
+            {
+                if (q_end - q < 2)
+                {
+                    return q - dst;
+                }
+                *q++ = ESCAPE_CHAR;
+                *q++ = c - SOF_CHAR;
+            }
+        }
+    }
+    return q - dst;
+}
+
+//  @brief Undo the escaping of a frame body (without SOF/EOF); dst may be
+//      the same as src, the frame is then unescaped in place.
+//  @param dst: output buffer, at least len bytes.
+//  @param src: escaped frame body.
+//  @param len: length of the escaped frame body.
+//  @retval number of bytes written to dst, or -1 if the body is malformed.
+
+int
+codec_unescape (uint8_t *dst, const uint8_t *src, size_t len)
+{
+    const uint8_t *end = src + len;
+    uint8_t *q = dst;
+    
+    while (src < end)
+    {
+        const uint8_t *p = src;
+        
+        // only the escape character matters, others are copied with the run
+        while ((p = scan_special (p, end)) < end && *p != ESCAPE_CHAR)
+        {
+            p++;
+        }
+        if (q != src)
+        {
+            memmove (q, src, p - src);
+        }
+        q += p - src;
+        src = p;
+        
+        while (src < end && *src == ESCAPE_CHAR)
+        {
+            if (src + 1 == end || src[1] > 2)
+            {
+                return -1;  // malformed frame
+            }
+            *q++ = SOF_CHAR + src[1];
+            src += 2;
+        }
+    }
+    return (int) (q - dst);
+}
+
+//  @brief Reference byte by byte version of codec_escape().
+
+size_t
+codec_escape_bytewise (uint8_t *dst, size_t dst_len, const uint8_t *src, size_t len)
+{
+    uint8_t *q = dst;
+    
+    for (size_t i = 0; i < len; i++)
+    {
+        switch (src[i])
+        {
+            case SOF_CHAR:
+            case EOF_CHAR:
+            case ESCAPE_CHAR:
+                if (q + 2 > dst + dst_len)
+                {
+                    return q - dst;
+                }
+                *q++ = ESCAPE_CHAR;
+                *q++ = src[i] - SOF_CHAR;
+                break;
+                
+            default:
+                if (q + 1 > dst + dst_len)
+                {
+                    return q - dst;
+                }
+                *q++ = src[i];
+        }
+    }
+    return q - dst;
+}
+
+//  @brief Reference byte by byte version of codec_unescape().
+
+int
+codec_unescape_bytewise (uint8_t *dst, const uint8_t *src, size_t len)
+{
+    uint8_t *q = dst;
+    
+    for (size_t i = 0; i < len; i++)
+    {
+        if (src[i] == ESCAPE_CHAR)
+        {
+            if (++i == len || src[i] > 2)
+            {
+                return -1;  // malformed frame
+            }
+            *q++ = SOF_CHAR + src[i];
+        }
+        else
+        {
+            *q++ = src[i];
+        }
+    }
+    return (int) (q - dst);
+}
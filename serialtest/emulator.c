@@ -0,0 +1,458 @@
+//
+//  emulator.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+// Radio module emulator: opens a pseudo-terminal and behaves like the radio
+// module on its serial side, so serialtest can be run without hardware:
+//
+//  radioemu [-p protocol] [-r rssi] [-b baudrate] [-v]
+//  serialtest -D <the slave tty printed by radioemu>
+//
+// Frames received from the host are looped back as if they came in over the
+// air, framed for the current protocol (0 - White, 1 - White+, 2 - Rotfunk+)
+// and tagged with the configured rssi; send them to the broadcast address or
+// to the host's own address to see them in its statistics. 0xCC commands are
+// recognized between frames and acknowledged with 0xCC, <command>, 0.
+
+#if defined (__linux__)
+#define _GNU_SOURCE     // posix_openpt() and friends
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <termios.h>
+#include <poll.h>
+#include <time.h>
+
+#include "frame-parser.h"
+#include "codec.h"
+
+#define EMU_DEBUG 0
+
+typedef enum
+{
+    EMU_IDLE = 0,   // between frames
+    EMU_COMMAND,    // collecting a 0xCC command
+    EMU_HEADER,     // White+ / Rotfunk+ header
+    EMU_WHITE,      // between SOF and EOF
+    EMU_RED,        // Rotfunk+ payload
+} emu_state_t;
+
+typedef struct
+{
+    int fd;
+    op_mode_t protocol;
+    int8_t rssi;
+    uint32_t baudrate;  // 0: no line rate pacing
+    bool verbose;
+    
+    emu_state_t state;
+    uint8_t buff[2 * MAX_FRAME_LEN];
+    size_t len;
+    size_t expected;
+    
+    // radio settings, as last set by the host
+    uint8_t channel;
+    uint8_t rate;
+    uint8_t slots;
+    uint8_t bw;
+    uint8_t region;
+    uint32_t frames_rx;
+    uint32_t frames_tx;
+} emulator_t;
+
+static const struct
+{
+    uint8_t code;
+    uint8_t params;
+    const char *name;
+} emu_commands[] =
+{
+    { 0x02, 1, "channel" },
+    { 0x03, 1, "master" },
+    { 0x50, 4, "baud" },
+    { 0x60, 1, "region" },
+    { 0x66, 1, "rate" },
+    { 0x67, 4, "hop" },
+    { 0x68, 1, "slots number" },
+    { 0x69, 2, "hop stretching" },
+    { 0x6A, 0, "traffic stats" },
+    { 0x6B, 0, "red traffic stats" },
+    { 0x80, 1, "protocol" },
+    { 0x81, 1, "slots" },
+    { 0x82, 1, "bw" },
+    { 0, 0, NULL }
+};
+
+
+//  @brief Write to the host, paced at the configured line rate.
+
+static void
+emu_write (emulator_t *emu, const uint8_t *data, size_t len)
+{
+    if (write (emu->fd, data, len) < 0 && errno != EIO)
+    {
+        perror ("pty write");
+    }
+    if (emu->baudrate)
+    {
+        // 10 bits per character on the wire
+        uint64_t ns = (uint64_t) len * 10 * 1000000000ULL / emu->baudrate;
+        struct timespec sts = { (time_t) (ns / 1000000000ULL), (long) (ns % 1000000000ULL) };
+        nanosleep (&sts, NULL);
+    }
+}
+
+//  @brief Loop a frame received from the host back, as received over the air.
+//  @param emu: emulator.
+//  @param data: frame content, unescaped.
+//  @param len: frame length.
+
+static void
+emu_loop_back (emulator_t *emu, const uint8_t *data, size_t len)
+{
+    uint8_t out[2 * MAX_FRAME_LEN + 8];
+    uint8_t *p = out;
+    
+    switch (emu->protocol)
+    {
+        case WHITE_RADIO:
+        case WHITE_RADIO_PLUS:
+            if (emu->protocol == WHITE_RADIO_PLUS)
+            {
+                *p++ = SOH_CHAR;
+                *p++ = 1;   // frame type
+                *p++ = (uint8_t) emu->rssi;
+            }
+            *p++ = SOF_CHAR;
+            p += codec_escape (p, sizeof (out) - (p - out) - 2, data, len);
+            *p++ = EOF_CHAR;
+            if (emu->protocol == WHITE_RADIO)
+            {
+                *p++ = (uint8_t) (emu->rssi * -1);
+            }
+            break;
+            
+        case ROTFUNK_PLUS:
+            *p++ = (uint8_t) len;
+            *p++ = 1;   // frame type
+            *p++ = (uint8_t) emu->rssi;
+            memcpy (p, data, len);
+            p += len;
+            break;
+            
+        default:
+            return;
+    }
+    emu_write (emu, out, p - out);
+    emu->frames_tx++;
+}
+
+//  @brief Execute a complete 0xCC command and acknowledge it.
+
+static void
+emu_command (emulator_t *emu, const uint8_t *cmd, size_t len, const char *name)
+{
+    uint8_t answer[12] = { 0xCC, cmd[1], 0 };
+    size_t answer_len = 3;
+    
+    switch (cmd[1])
+    {
+        case 0x02:
+            emu->channel = cmd[2];
+            break;
+            
+        case 0x50:
+            // the host changes its own rate right after; so do we
+            {
+                struct termios options;
+                uint32_t baud = cmd[2] | (cmd[3] << 8) | (cmd[4] << 16) | ((uint32_t) cmd[5] << 24);
+                if (emu->baudrate)
+                {
+                    emu->baudrate = baud;
+                }
+                if (tcgetattr (emu->fd, &options) == 0)
+                {
+                    cfsetspeed (&options, baud);
+                    tcsetattr (emu->fd, TCSANOW, &options);
+                }
+            }
+            break;
+            
+        case 0x60:
+            emu->region = cmd[2];
+            break;
+            
+        case 0x66:
+            emu->rate = cmd[2];
+            break;
+            
+        case 0x6A:
+        case 0x6B:
+            for (int i = 0; i < 4; i++)
+            {
+                answer[3 + i] = (uint8_t) (emu->frames_rx >> (8 * i));
+                answer[7 + i] = (uint8_t) (emu->frames_tx >> (8 * i));
+            }
+            answer_len = 11;
+            break;
+            
+        case 0x80:
+            emu->protocol = cmd[2] & 3;
+            break;
+            
+        case 0x81:
+            emu->slots = cmd[2];
+            break;
+            
+        case 0x82:
+            emu->bw = cmd[2];
+            break;
+            
+        default:
+            break;  // accepted, no effect
+    }
+    if (emu->verbose)
+    {
+        fprintf (stdout, "command %02x (%s), %lu bytes\n", cmd[1], name, len);
+    }
+    emu_write (emu, answer, answer_len);
+}
+
+//  @brief Process bytes received from the host.
+
+static void
+emu_feed (emulator_t *emu, const uint8_t *data, size_t len)
+{
+    static const char *command_name;
+    
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = data[i];
+        
+        switch (emu->state)
+        {
+            case EMU_IDLE:
+                emu->len = 0;
+                if (c == 0xCC)
+                {
+                    emu->buff[emu->len++] = c;
+                    emu->expected = 2;
+                    emu->state = EMU_COMMAND;
+                }
+                else if (emu->protocol == ROTFUNK_PLUS)
+                {
+                    emu->expected = c;
+                    emu->state = EMU_HEADER;
+                    emu->buff[emu->len++] = c;
+                }
+                else if (c == SOH_CHAR)
+                {
+                    emu->expected = 4;  // SOH, frame type, slot, then the SOF
+                    emu->state = EMU_HEADER;
+                    emu->buff[emu->len++] = c;
+                }
+                else if (c == SOF_CHAR)
+                {
+                    emu->state = EMU_WHITE;
+                }
+                break;
+                
+            case EMU_COMMAND:
+                emu->buff[emu->len++] = c;
+                if (emu->len == 2)
+                {
+                    int k;
+                    for (k = 0; emu_commands[k].name && emu_commands[k].code != c; k++)
+                        ;
+                    if (emu_commands[k].name == NULL)
+                    {
+                        emu->state = EMU_IDLE;  // not a command we know
+                        break;
+                    }
+                    command_name = emu_commands[k].name;
+                    emu->expected = 2 + emu_commands[k].params;
+                }
+                if (emu->len == emu->expected)
+                {
+                    emu_command (emu, emu->buff, emu->len, command_name);
+                    emu->state = EMU_IDLE;
+                }
+                break;
+                
+            case EMU_HEADER:
+                emu->buff[emu->len++] = c;
+                if (emu->protocol == ROTFUNK_PLUS)
+                {
+                    if (emu->len == sizeof (red_header_t))
+                    {
+                        emu->len = 0;
+                        emu->state = emu->expected ? EMU_RED : EMU_IDLE;
+                    }
+                }
+                else if (emu->len == emu->expected)
+                {
+                    emu->state = (c == SOF_CHAR) ? EMU_WHITE : EMU_IDLE;
+                    emu->len = 0;
+                }
+                break;
+                
+            case EMU_WHITE:
+                if (c == EOF_CHAR)
+                {
+                    int count = codec_unescape (emu->buff, emu->buff, emu->len);
+                    if (count > 0)
+                    {
+                        emu->frames_rx++;
+                        emu_loop_back (emu, emu->buff, count);
+                    }
+                    emu->state = EMU_IDLE;
+                }
+                else if (c == SOF_CHAR)
+                {
+                    emu->len = 0;
+                }
+                else if (emu->len < sizeof (emu->buff))
+                {
+                    emu->buff[emu->len++] = c;
+                }
+                else
+                {
+                    emu->state = EMU_IDLE;
+                }
+                break;
+                
+            case EMU_RED:
+                emu->buff[emu->len++] = c;
+                if (emu->len == emu->expected)
+                {
+                    emu->frames_rx++;
+                    emu_loop_back (emu, emu->buff, emu->len);
+                    emu->state = EMU_IDLE;
+                }
+                break;
+        }
+    }
+}
+
+int
+main (int argc, char * argv[])
+{
+    emulator_t emu;
+    struct termios options;
+    uint8_t buff[4096];
+    int ch;
+    
+    memset (&emu, 0, sizeof (emu));
+    emu.protocol = WHITE_RADIO;
+    emu.rssi = -40;
+    
+    while ((ch = getopt (argc, argv, "hvp:r:b:")) != -1)
+    {
+        switch (ch)
+        {
+            case 'p':
+                emu.protocol = atoi (optarg) & 3;
+                break;
+                
+            case 'r':
+                emu.rssi = atoi (optarg);
+                break;
+                
+            case 'b':
+                emu.baudrate = atoi (optarg);
+                break;
+                
+            case 'v':
+                emu.verbose = true;
+                break;
+                
+            case 'h':
+            default:
+                fprintf (stdout, "Usage: radioemu [-p protocol] [-r rssi] [-b baudrate] [-v]\n");
+                fprintf (stdout, "\tprotocol: 0 - white, 1 - white+, 2 - red+; rssi in dBm (default -40)\n");
+                fprintf (stdout, "\t-b paces the looped back frames at the given line rate\n");
+                exit (EXIT_SUCCESS);
+                break;
+        }
+    }
+    
+    signal (SIGPIPE, SIG_IGN);
+    
+    if ((emu.fd = posix_openpt (O_RDWR | O_NOCTTY)) < 0 ||
+        grantpt (emu.fd) < 0 || unlockpt (emu.fd) < 0)
+    {
+        perror ("pseudo-terminal");
+        exit (EXIT_FAILURE);
+    }
+    
+    // raw, as the module's UART
+    tcgetattr (emu.fd, &options);
+    cfmakeraw (&options);
+    tcsetattr (emu.fd, TCSANOW, &options);
+    
+    fprintf (stdout, "Radio module emulator on %s\n", ptsname (emu.fd));
+    fflush (stdout);
+    
+    while (true)
+    {
+        struct pollfd pfd = { emu.fd, POLLIN, 0 };
+        ssize_t res;
+        
+        if (poll (&pfd, 1, -1) < 0)
+        {
+            perror ("poll");
+            break;
+        }
+        if ((res = read (emu.fd, buff, sizeof (buff))) > 0)
+        {
+#if EMU_DEBUG == 1
+            fprintf (stdout, "got %ld bytes\n", res);
+#endif
+            emu_feed (&emu, buff, res);
+        }
+        else if (res < 0 && errno == EIO)
+        {
+            // no one has the slave side open (yet)
+            struct timespec sts = { 0, 100000000 };
+            nanosleep (&sts, NULL);
+        }
+        else if (res < 0 && errno != EINTR && errno != EAGAIN)
+        {
+            perror ("pty read");
+            break;
+        }
+    }
+    
+    return EXIT_SUCCESS;
+}
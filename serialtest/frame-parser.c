@@ -28,22 +28,25 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stddef.h>
 #include <termios.h>
 #include <sys/time.h>
-#include <sys/ioctl.h>
-#include <IOKit/serial/ioss.h>
 
 #include "utils.h"
 #include "frame-parser.h"
+#include "scanner.h"
+#include "codec.h"
+#include "serial.h"
+#include "port.h"
+#include "capture.h"
+#include "seqlock.h"
 
 #define PARSER_DEBUG 0
 #define SERIAL_DEBUG 0
 
-pthread_mutex_t send_serial_mutex = PTHREAD_MUTEX_INITIALIZER;
-ipc_t ipc;
 
 ssize_t
-send_command (int fd, uint8_t *command, size_t cmd_len, size_t max_len);
+send_command (port_t *port, uint8_t *command, size_t cmd_len, size_t max_len);
 
 
 //  @brief This function parses 0xf0/0xf1 (begin/end) type frames.
@@ -65,9 +68,14 @@ parse_f0_f1_frames (uint8_t **begin, uint8_t **end, int8_t *rssi)
     fprintf (stdout, "in %ld, ", *end - *begin + 1);
 #endif
     
-    // find the frame's start
-    while (*p != SOF_CHAR && *p != SOH_CHAR && p < *end)
+    // find the frame's start, skipping whole blocks of ordinary bytes
+    while (p < *end)
     {
+        p = (uint8_t *) scan_special (p, *end);
+        if (p == *end || *p == SOF_CHAR || *p == SOH_CHAR)
+        {
+            break;
+        }
         p++;
     }
     
@@ -92,8 +100,13 @@ parse_f0_f1_frames (uint8_t **begin, uint8_t **end, int8_t *rssi)
         if (p < *end)
             p++;   // and get over it
         
-        while (*p != EOF_CHAR && p < *end)
+        while (p < *end)
         {
+            p = (uint8_t *) scan_special (p, *end);
+            if (p == *end || *p == EOF_CHAR)
+            {
+                break;
+            }
             if (*p == SOF_CHAR)
             {
                 *begin = p;  // new frame start, reset search
@@ -138,12 +151,246 @@ parse_f0_f1_frames (uint8_t **begin, uint8_t **end, int8_t *rssi)
     return result;
 }
 
+//  @brief Initialize a streaming 0xf0/0xf1 parser context.
+//  @param ctx: parser context.
+//  @param handler: function called for every complete frame; it gets the
+//      unescaped frame (without SOF/EOF and rssi), its length and the rssi.
+//  @param arg: opaque pointer passed to the handler.
+
+void
+parser_init (parser_ctx_t *ctx, frame_handler_t handler, void *arg)
+{
+    ctx->handler = handler;
+    ctx->arg = arg;
+    parser_reset (ctx);
+}
+
+//  @brief Drop any partially received frame and start hunting for a new one.
+//  @param ctx: parser context.
+
+void
+parser_reset (parser_ctx_t *ctx)
+{
+    ctx->state = PARSER_IDLE;
+    ctx->white_plus = false;
+    ctx->rssi = 0;
+    ctx->header_count = 0;
+    ctx->len = 0;
+}
+
+//  @brief Hand a complete frame to the handler and get ready for the next one.
+
+static void
+parser_emit (parser_ctx_t *ctx, const uint8_t *data, size_t len, int8_t rssi)
+{
+    frame_view_t view;
+    
+    view.data = data;
+    view.len = len;
+    view.rssi = rssi;
+    view.arrival = ctx->arrival;
+    ctx->handler (ctx->arg, &view);
+    parser_reset (ctx);
+}
+
+//  @brief Append bytes to the parser's scratch buffer.
+//  @retval false if the frame got too long (the parser is then reset).
+
+static bool
+parser_append (parser_ctx_t *ctx, const uint8_t *data, size_t len)
+{
+    if (ctx->len + len > sizeof (ctx->frame))
+    {
+        parser_reset (ctx);    // too long, can't be ours
+        return false;
+    }
+    memcpy (ctx->frame + ctx->len, data, len);
+    ctx->len += len;
+    return true;
+}
+
+//  @brief Feed received bytes to a streaming 0xf0/0xf1 parser. Every byte is
+//      looked at exactly once; frames may be split across any number of
+//      calls, the state is carried in the context. A frame that lies whole
+//      in buff and has no escapes is handed over in place, without copying;
+//      only the others go through the scratch buffer. That is the codec's
+//      scheme, with the runs found by scan_special() and the escapes done
+//      one by one, fused with the framing: calling codec_unescape() on the
+//      frames with escapes would scan them a second time.
+//  @param ctx: parser context.
+//  @param buff: received bytes.
+//  @param len: number of received bytes.
+//  @param arrival: when the bytes were received (CLOCK_MONOTONIC, ns).
+
+void
+parser_feed (parser_ctx_t *ctx, const uint8_t *buff, size_t len, uint64_t arrival)
+{
+    const uint8_t *p = buff;
+    const uint8_t *end = buff + len;
+    const uint8_t *start = NULL;    // frame body start, while it is still in place
+    
+    ctx->arrival = arrival;
+    
+    while (p < end)
+    {
+        uint8_t c = *p;
+        
+        switch (ctx->state)
+        {
+            case PARSER_IDLE:
+                p = scan_special (p, end);
+                if (p == end)
+                {
+                    break;
+                }
+                c = *p++;
+                if (c == SOH_CHAR)
+                {
+                    ctx->header_count = 0;
+                    ctx->state = PARSER_HEADER;
+                }
+                else if (c == SOF_CHAR)
+                {
+                    ctx->white_plus = false;
+                    ctx->len = 0;
+                    ctx->state = PARSER_FRAME;
+                    start = p;
+                }
+                break;
+                
+            case PARSER_HEADER:
+                // SOH, frame type, rssi, then the frame must begin
+                if (ctx->header_count < 2)
+                {
+                    if (ctx->header_count == 1)
+                    {
+                        ctx->rssi = (int8_t) c;
+                    }
+                    ctx->header_count++;
+                    p++;
+                }
+                else if (c == SOF_CHAR)
+                {
+                    ctx->white_plus = true;
+                    ctx->len = 0;
+                    ctx->state = PARSER_FRAME;
+                    start = ++p;
+                }
+                else
+                {
+                    ctx->state = PARSER_IDLE;  // not a header, look at c again
+                }
+                break;
+                
+            case PARSER_FRAME:
+            {
+                // skip (or copy, if no longer in place) the run of ordinary bytes
+                const uint8_t *q = scan_special (p, end);
+                if (start == NULL && q > p && !parser_append (ctx, p, q - p))
+                {
+                    p = q;
+                    break;
+                }
+                p = q;
+                if (p == end)
+                {
+                    break;
+                }
+                c = *p++;
+                
+                if (c == EOF_CHAR)
+                {
+                    if (start != NULL)
+                    {
+                        size_t n = p - 1 - start;
+                        if (n > sizeof (ctx->frame))
+                        {
+                            parser_reset (ctx);
+                        }
+                        else if (ctx->white_plus)
+                        {
+                            parser_emit (ctx, start, n, ctx->rssi);
+                        }
+                        else if (p < end)
+                        {
+                            parser_emit (ctx, start, n, (int8_t) (*p++ * -1));
+                        }
+                        else
+                        {
+                            // the rssi byte comes with the next read
+                            parser_append (ctx, start, n);
+                            ctx->state = PARSER_RSSI;
+                        }
+                        start = NULL;
+                    }
+                    else if (ctx->white_plus)
+                    {
+                        parser_emit (ctx, ctx->frame, ctx->len, ctx->rssi);
+                    }
+                    else
+                    {
+                        ctx->state = PARSER_RSSI;
+                    }
+                }
+                else if (c == SOF_CHAR)
+                {
+                    ctx->len = 0;   // new frame start, drop the old one
+                    start = p;
+                }
+                else if (c == ESCAPE_CHAR)
+                {
+                    // from here on the frame is assembled in the scratch buffer
+                    if (start != NULL)
+                    {
+                        bool fits = parser_append (ctx, start, p - 1 - start);
+                        start = NULL;
+                        if (!fits)
+                        {
+                            break;
+                        }
+                    }
+                    ctx->state = PARSER_ESCAPE;
+                }
+                else if (start == NULL)
+                {
+                    parser_append (ctx, &c, 1); // 0xf3 is plain data here
+                }
+                break;
+            }
+                
+            case PARSER_ESCAPE:
+                if (c <= 2 && ctx->len < sizeof (ctx->frame))
+                {
+                    ctx->frame[ctx->len++] = SOF_CHAR + c;
+                    ctx->state = PARSER_FRAME;
+                    p++;
+                }
+                else
+                {
+                    parser_reset (ctx);    // malformed frame, look at c again
+                }
+                break;
+                
+            case PARSER_RSSI:
+                parser_emit (ctx, ctx->frame, ctx->len, (int8_t) (c * -1));
+                p++;
+                break;
+        }
+    }
+    
+    if (start != NULL && ctx->state == PARSER_FRAME)
+    {
+        // frame continues with the next read, keep what we have so far
+        parser_append (ctx, start, end - start);
+    }
+}
+
 //  @brief Print an 0xf0/0xf1 frame to the console.
 //  @param buff: buffer containing the frame.
 //  @param len: length of the frame.
 
 void
-print_frames (uint8_t *buff, size_t len, int8_t rssi)
+print_frames (const uint8_t *buff, size_t len, int8_t rssi)
 {
     fprintf (stdout, "%3ld bytes, rssi %03d dBm: ", len, rssi);
     
@@ -163,54 +410,112 @@ print_frames (uint8_t *buff, size_t len, int8_t rssi)
 int
 extract_f0_f1_frame (uint8_t *buff, size_t len)
 {
-    uint8_t *p = buff;
-    uint8_t *q = buff;
-    int count = 0;
+    uint8_t *eof;
+    int count = -1;
     
     if ((buff[len - 2] == EOF_CHAR || buff[len - 1] == EOF_CHAR) && *buff == SOF_CHAR) // do we have a valid frame + rssi?
     {
-        p++;    // skip the start of frame (0xf0)
-        while (*p != EOF_CHAR)
+        eof = memchr (buff + 1, EOF_CHAR, len - 1);
+        count = codec_unescape (buff, buff + 1, eof - buff - 1);   // skip the start of frame (0xf0)
+        if (count >= 0)
         {
-            if (*p == ESCAPE_CHAR)
-            {
-                p++;
-                if (*p == 0)
-                    *q = SOF_CHAR;
-                else if (*p == 1)
-                    *q = EOF_CHAR;
-                else if (*p == 2)
-                    *q = ESCAPE_CHAR;
-                else
-                    break;  // error! malformed frame
-                q++;
-                p++;
-            }
-            else
-            {
-                *q++ = *p++;
-            }
-        }
-        if (*p++ != EOF_CHAR)
-        {
-            count = -1;
-        }
-        else
-        {
-            *q = *p;    // copy rssi at the end of the frame
-            count = (int) (q - buff) + 1;
+            buff[count] = (eof + 1 < buff + len) ? eof[1] : 0; // copy rssi at the end of the frame
+            count++;
         }
     }
-    else
+    
+    return count;
+}
+
+// Hand what was just written to the capture, if one is running.
+static void
+capture_tx (port_t *port, capture_dir_t dir, const uint8_t *buff, size_t len, uint64_t when)
+{
+    capture_t *cap = __atomic_load_n (&g_capture, __ATOMIC_ACQUIRE);
+    
+    if (cap != NULL)
+    {
+        capture_write (cap, dir, port, buff, len, when);
+    }
+}
+
+// Count frames just written in the TX counters.
+static void
+count_tx (port_t *port, unsigned frames, size_t bytes, uint64_t when)
+{
+    seqlock_write_begin (&port->tx.lock);
+    if (port->tx.frames == 0)
     {
-        count = -1; // invalid frame
+        port->tx.first = when;
     }
+    port->tx.last = when;
+    port->tx.frames += frames;
+    port->tx.bytes += bytes;
+    seqlock_write_end (&port->tx.lock);
+}
+
+// Echo a ping: a PONG frame back to its sender, with the same payload.
+static void
+send_pong (port_t *port, const ipc_t *msg, uint8_t index)
+{
+    uint8_t buff[sizeof (frame_hdr_t) + sizeof (pong_t) + 2];
+    uint8_t encoded[MAX_FRAME_LEN];
+    frame_t *pong = (frame_t *) buff;
+    size_t count = sizeof (frame_hdr_t) + msg->parameter0;
+    uint64_t now = monotonic_ns ();
+    uint16_t crc;
+    size_t len;
     
-    return count;
+    pong->header.len = count;
+    pong->header.dest = msg->address;
+    pong->header.src = port->address;
+    pong->header.index = index;
+    pong->header.type = PONG;
+    pong->header.timestamp = (uint32_t) ((now % 1000000000) / 1000);
+    memcpy (pong->payload, msg->text, msg->parameter0);
+    if (msg->parameter0 >= sizeof (pong_t))
+    {
+        // as late as possible: the peer takes it as the time on the wire
+        memcpy (pong->payload + offsetof (pong_t, replied), &now, sizeof (now));
+    }
+    crc = calcCRC (0, buff, (int) count);
+    buff[count] = (uint8_t) crc;
+    buff[count + 1] = (uint8_t) (crc >> 8);
+    
+    len = encode_frame (encoded, buff, (int) count + 2, port->mode, 0);
+    if (write (port->fd, encoded, len) > 0)
+    {
+        now = monotonic_ns ();
+        tx_track_write (&port->track, port->fd, port->baudrate, len, now);
+        capture_tx (port, CAPTURE_TX, encoded, len, now);
+        count_tx (port, 1, len, now);
+    }
 }
 
-// @brief Send frames over the serial port.
-// @param p: void pointer, contains the file descriptor of the serial port.
+// Lazy drain for bursts: instead of waiting for the line to go idle after
+// every write, hold back only while the driver has more than one batch
+// queued, so a batch is encoded while the previous one is on the wire.
+static void
+wait_tx_room (port_t *port, size_t batch)
+{
+    struct timespec sts;
+    int queued;
+    
+    while ((queued = serial_outq (port->fd)) > (int) batch)
+    {
+        // sleep for about the time the excess needs on the wire (8N1)
+        uint64_t ns = (uint64_t) (queued - batch) * 10 * 1000000000 / port->baudrate;
+        sts.tv_sec = (time_t) (ns / 1000000000);
+        sts.tv_nsec = (long) (ns % 1000000000);
+        nanosleep (&sts, NULL);
+        seqlock_write_begin (&port->tx.lock);
+        port->tx.stalls++;
+        seqlock_write_end (&port->tx.lock);
+    }
+}
+
+// @brief Send frames over the serial port; the sender thread of a port.
+// @param p: void pointer, the port_t to send on.
 // @retval a null pointer.
 
 void *
@@ -219,8 +524,8 @@ send_frames (void *p)
     /* note: the frame is 90 bytes long + 2 bytes CRC. This is close to the maximum permissible
      for a 3.5 ms frame at 250 Kbps OQPSK (e.g. ZigBee) */
 #define LOCAL_BUFFER_SIZE 120
-    static int frame_size = 22;  // default
-    int fd = *(int *) p;
+    port_t *port = p;
+    int fd = port->fd;
     uint8_t send_buffer[LOCAL_BUFFER_SIZE + 2];    // +2 for CRC
     uint8_t cc_buffer[20];
     struct timespec sts;
@@ -228,12 +533,15 @@ send_frames (void *p)
     bool send_one_time = false;
     frame_t *frame;
     uint8_t dest_address = 0;
-#if USE_IOSSIOSPEED == false
-    struct termios options;
-#endif
+    int frame_size = FRAME_SIZE_DEFAULT;
     int count = frame_size - sizeof (frame_hdr_t);
-    static int interval = 20; // ms
     uint8_t slot = 0;
+    int burst = 1;
+    uint8_t tx_buffer[MAX_BURST * MAX_FRAME_LEN];
+    uint64_t written;
+    bool ping = false;
+    uint32_t seq = 0;   // every frame takes one, the index follows it
+    ipc_t msg;
     
     // set cmd/data line to data (true)
     if (cmd_data(fd, true) == false)
@@ -243,44 +551,70 @@ send_frames (void *p)
     
     frame = (frame_t *) &send_buffer;
     frame->header.index = 0;
-    frame->header.src = own_address(GET_PARAMETER, 0);
+    frame->header.src = port->address;
     
     while (true)
     {
-        pthread_mutex_lock (&send_serial_mutex);
-        if (ipc.cmd)
+        // drain all pending commands
+        while (cmd_queue_pop (&port->queue, &msg))
         {
-            switch (ipc.cmd)
+            switch (msg.cmd)
             {
                 case SEND_LOW_LATENCY_FRAMES:
                 case SEND_LOW_LATENCY_FRAMES_WITH_HEADER:
-                    dest_address = ipc.address;
+                case SEND_PING_FRAMES:
+                    ping = (msg.cmd == SEND_PING_FRAMES);
+                    dest_address = msg.address;
                     count = frame_size;
+                    if (!send_periodically)
+                    {
+                        tx_sched_start (&port->sched);
+                    }
                     send_periodically = true;
-                    slot = ipc.parameter0;
+                    slot = msg.parameter0;
                     break;
                     
                 case SEND_PLAIN_FRAME:
-                    write (fd, ipc.text, ipc.parameter0);
+                    if (write (fd, msg.text, msg.parameter0) > 0)
+                    {
+                        written = monotonic_ns ();
+                        tx_track_write (&port->track, fd, port->baudrate, msg.parameter0, written);
+                        capture_tx (port, CAPTURE_TX, msg.text, msg.parameter0, written);
+                    }
                     break;
                     
                 case STOP_LOW_LATENCY_FRAMES:
                     send_periodically = false;
                     break;
                     
+                case SEND_PONG:
+                    // echo right away, ahead of any scheduled frame
+                    frame->header.index = (uint8_t) ++seq;
+                    send_pong (port, &msg, frame->header.index);
+                    break;
+                    
+                case CLEAR_STATS:
+                    port_clear_tx (port);
+                    __atomic_add_fetch (&port->tx_clears, 1, __ATOMIC_RELEASE);
+                    break;
+                    
                 case INTERVAL:
-                    interval = ipc.parameter0;
+                    tx_sched_set_period (&port->sched, msg.parameter0);
                     break;
                     
                 case LENGTH:
-                    frame_size = ipc.parameter0;
+                    frame_size = msg.parameter0;
+                    break;
+                    
+                case BURST:
+                    burst = msg.parameter0;
                     break;
 
                 case SET_CHANNEL:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x02;    // set/get channel
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    if (send_command (fd, cc_buffer, 3, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    if (send_command (port, cc_buffer, 3, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -289,8 +623,8 @@ send_frames (void *p)
                 case SET_MASTER:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x03;    // set/get channel
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    if (send_command (fd, cc_buffer, 3, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    if (send_command (port, cc_buffer, 3, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -299,8 +633,8 @@ send_frames (void *p)
                 case SET_RATE:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x66;    // set/get bit rate
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    if (send_command (fd, cc_buffer, 3, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    if (send_command (port, cc_buffer, 3, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -309,11 +643,11 @@ send_frames (void *p)
                 case SET_HOP_PARAMS:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x67;    // set/get hop parameters
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    cc_buffer[3] = (ipc.parameter0 >> 8) & 0xff;
-                    cc_buffer[4] = ipc.parameter1 & 0xff;
-                    cc_buffer[5] = (ipc.parameter1 >> 8) & 0xff;
-                    if (send_command (fd, cc_buffer, 6, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    cc_buffer[3] = (msg.parameter0 >> 8) & 0xff;
+                    cc_buffer[4] = msg.parameter1 & 0xff;
+                    cc_buffer[5] = (msg.parameter1 >> 8) & 0xff;
+                    if (send_command (port, cc_buffer, 6, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -324,8 +658,8 @@ send_frames (void *p)
 
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x68;    // set/get slots number
-                    cc_buffer[2] = ipc.parameter2 & 0xff;
-                    if (send_command (fd, cc_buffer, 3, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter2 & 0xff;
+                    if (send_command (port, cc_buffer, 3, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -334,57 +668,41 @@ send_frames (void *p)
                 case SET_HOP_STRETCHING:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x69;    // set/get hop stretching
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    cc_buffer[3] = (ipc.parameter0 >> 8) & 0xff;
-                    if (send_command (fd, cc_buffer, 4, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    cc_buffer[3] = (msg.parameter0 >> 8) & 0xff;
+                    if (send_command (port, cc_buffer, 4, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
                     break;
 
                 case SET_BAUD:
-#if USE_IOSSIOSPEED == false
-                    tcgetattr (fd, &options);
-                    cfsetispeed (&options, ipc.parameter0);
-                    cfsetospeed (&options, ipc.parameter0);
-#endif
-
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x50;    // set baud rate
-#if USE_IOSSIOSPEED == false
-                    if (ipc.parameter0 == 300)
-                    {
-                        // handle special case 300 baud which is aliased to 288000
-                        ipc.parameter0 = 288000;
-                    }
-#endif
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    cc_buffer[3] = (ipc.parameter0 >> 8) & 0xff;
-                    cc_buffer[4] = (ipc.parameter0 >> 16) & 0xff;
-                    cc_buffer[5] = (ipc.parameter0 >> 24) & 0xff;
-                    if (send_command (fd, cc_buffer, 6, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    cc_buffer[3] = (msg.parameter0 >> 8) & 0xff;
+                    cc_buffer[4] = (msg.parameter0 >> 16) & 0xff;
+                    cc_buffer[5] = (msg.parameter0 >> 24) & 0xff;
+                    if (send_command (port, cc_buffer, 6, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
-#if USE_IOSSIOSPEED == false
-                    if (tcsetattr (fd, TCSAFLUSH, &options) < 0)
+                    // send_command() has drained the line
+                    if (serial_set_baudrate (fd, msg.parameter0) < 0)
                     {
-                        fprintf (stdout, "Failed to set new baudrate\n");
+                       fprintf (stdout, "Failed to set new baudrate\n");
                     }
-#else
-                    speed_t speed = ipc.parameter0;
-                    if (ioctl(fd, IOSSIOSPEED, &speed) == -1 )
+                    else
                     {
-                       fprintf (stdout, "Failed to set new baudrate\n");
+                        port->baudrate = msg.parameter0;
                     }
-#endif
                     break;
                     
                 case SET_SLOT:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x81;    // set/get slots
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    if (send_command (fd, cc_buffer, 3, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    if (send_command (port, cc_buffer, 3, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -393,8 +711,8 @@ send_frames (void *p)
                 case SET_BW:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x82;    // set bandwidth
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    if (send_command (fd, cc_buffer, 3, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    if (send_command (port, cc_buffer, 3, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -403,8 +721,8 @@ send_frames (void *p)
                 case SET_REGION:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x60;    // get/set region
-                    cc_buffer[2] = ipc.parameter0 & 0xff;
-                    if (send_command (fd, cc_buffer, 3, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 0xff;
+                    if (send_command (port, cc_buffer, 3, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -413,19 +731,19 @@ send_frames (void *p)
                 case SET_PROTOCOL:
                     cc_buffer[0] = 0xcc;
                     cc_buffer[1] = 0x80;    // set protocol
-                    cc_buffer[2] = ipc.parameter0 & 3;
-                    if (send_command (fd, cc_buffer, 3, sizeof(cc_buffer)) < 0)
+                    cc_buffer[2] = msg.parameter0 & 3;
+                    if (send_command (port, cc_buffer, 3, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
-                    set_mode (ipc.parameter0);
+                    __atomic_store_n (&port->mode, (op_mode_t) msg.parameter0, __ATOMIC_RELAXED);
                     break;
                     
                 case GET_TRAFFIC_STATS:
                 case GET_RED_TRAFFIC_STATS:
                     cc_buffer[0] = 0xcc;
-                    cc_buffer[1] = (ipc.cmd == GET_TRAFFIC_STATS) ? 0x6A : 0x6B;    // get stats
-                    if (send_command (fd, cc_buffer, 2, sizeof(cc_buffer)) < 0)
+                    cc_buffer[1] = (msg.cmd == GET_TRAFFIC_STATS) ? 0x6A : 0x6B;    // get stats
+                    if (send_command (port, cc_buffer, 2, sizeof(cc_buffer)) < 0)
                     {
                         perror("send command:");
                     }
@@ -435,61 +753,136 @@ send_frames (void *p)
                     // unknown command
                     break;
             }
-            ipc.cmd = NOP;
+            // the serial commands are drained by now, so this is issue to wire
+            uint64_t done = monotonic_ns ();
+            if (msg.cmd == SEND_PONG)
+            {
+                ping_turnaround (&port->ping, (done - msg.issued) / 1000);
+            }
+            else if (msg.cmd != CLEAR_STATS)
+            {
+                tx_sched_command (&port->sched, done - msg.issued);
+            }
+        }
+        
+        // retire the frames that left meanwhile, then sleep until the next
+        // deadline, if sending, until the next frame should be out, or until
+        // a command comes
+        uint64_t poll_at = tx_track_poll (&port->track, fd, port->baudrate);
+        if (!send_one_time && !tx_sched_wait (&port->sched, send_periodically, poll_at))
+        {
+            continue;
         }
-        pthread_mutex_unlock (&send_serial_mutex);
         
         if (send_periodically || send_one_time)
         {
-            frame->header.index += 1;
-            
-            struct timespec tp;
-            clock_gettime (CLOCK_MONOTONIC, &tp);
-            frame->header.timestamp = (uint32_t) (tp.tv_nsec / 1000);
+            size_t len = 0;
+            size_t frame_len[MAX_BURST];
             
-            if (!send_one_time)
+            // encode the whole burst back to back, to go out with one write
+            for (int i = 0; i < burst; i++)
             {
-                frame->header.type = LOW_LATENCY;
-                frame->header.dest = dest_address;
-                memset (&frame->payload, 0x55, frame_size - sizeof (frame_hdr_t));
-                count = frame_size;
-                frame->header.len = count;
+                frame->header.index = (uint8_t) ++seq;
+                
+                uint64_t now = monotonic_ns ();
+                // the short timestamp is always there, for older receivers
+                frame->header.timestamp = (uint32_t) ((now % 1000000000) / 1000);
+                
+                if (!send_one_time)
+                {
+                    frame->header.type = ping ? PING : LOW_LATENCY;
+                    frame->header.dest = dest_address;
+                    memset (&frame->payload, 0x55, frame_size - sizeof (frame_hdr_t));
+                    count = frame_size;
+                    
+                    if (ping)
+                    {
+                        ping_t pg;
+                        pg.seq = ping_issue (&port->ping);
+                        pg.sent = now;
+                        memcpy (&frame->payload, &pg, sizeof (pg));
+                        if (count < sizeof (frame_hdr_t) + sizeof (ping_t))
+                        {
+                            count = sizeof (frame_hdr_t) + sizeof (ping_t);
+                        }
+                    }
+                    frame->header.len = count;
+                    
+                    if (!ping && ext_header (GET_PARAMETER, false) &&
+                        frame_size >= sizeof (frame_hdr_t) + offsetof (frame_ext_t, seq))
+                    {
+                        frame_ext_t ext;
+                        // frames too short for the sequence number get a
+                        // version 1 extension, the timestamp only
+                        if (frame_size >= sizeof (frame_hdr_t) + sizeof (frame_ext_t))
+                        {
+                            ext.version = FRAME_EXT_VERSION;
+                            ext.len = sizeof (frame_ext_t);
+                        }
+                        else
+                        {
+                            ext.version = 1;
+                            ext.len = offsetof (frame_ext_t, seq);
+                        }
+                        ext.timestamp = now;
+                        ext.seq = seq;
+                        memcpy (&frame->payload, &ext, ext.len);
+                        frame->header.type |= FRAME_TYPE_EXT;
+                    }
+                }
+                
+                // compute frame's CRC
+                uint16_t crc = calcCRC(0, send_buffer, count);
+                send_buffer[count] = (uint8_t) crc;
+                send_buffer[count + 1] = (uint8_t) (crc >> 8) & 0xFF;
+                
+                frame_len[i] = encode_frame (tx_buffer + len, send_buffer, count + 2, port->mode, slot);
+                len += frame_len[i];
             }
             
-            // compute frame's CRC
-            uint16_t crc = calcCRC(0, send_buffer, count);
-            send_buffer[count] = (uint8_t) crc;
-            send_buffer[count + 1] = (uint8_t) (crc >> 8) & 0xFF;
-            
-            count += 2;
-            if (send_frame (fd, send_buffer, count, get_mode (), slot) < 0)
+            if (burst > 1)
+            {
+                wait_tx_room (port, len);
+            }
+            if (write (fd, tx_buffer, len) < 0)
             {
                 perror("serial port write");
                 break;
             }
             
+            // no waiting for the line here, the frames are tracked instead
+            written = monotonic_ns ();
+            for (int i = 0; i < burst; i++)
+            {
+                tx_track_write (&port->track, fd, port->baudrate, frame_len[i], written);
+            }
+            capture_tx (port, CAPTURE_TX, tx_buffer, len, written);
+            count_tx (port, burst, len, written);
+            
             if (send_one_time)
             {
                 send_one_time = false;
             }
         }
-        
-        sts.tv_nsec = interval * 1000000;
-        sts.tv_sec = 0;
-        nanosleep (&sts, NULL);
     }
     
+    __atomic_store_n (&port->tx_running, false, __ATOMIC_RELEASE);
     pthread_exit (NULL);
 }
 
 
-ssize_t
-send_frame (int fd, uint8_t *frame, int count, op_mode_t type, uint8_t slot)
+//  @brief Encode a frame in the framing of the current protocol.
+//  @param dst: output buffer, room for MAX_FRAME_LEN bytes.
+//  @param frame: the frame, CRC included.
+//  @param count: length of the frame.
+//  @param type: protocol.
+//  @param slot: slot number, for the protocols with a header.
+//  @retval number of bytes to write to the serial port.
+
+size_t
+encode_frame (uint8_t *dst, const uint8_t *frame, int count, op_mode_t type, uint8_t slot)
 {
-    uint8_t send_buffer[MAX_FRAME_LEN];
-    uint8_t *p = send_buffer;
-    int i;
-    ssize_t result;
+    uint8_t *p = dst;
     
     if (type > WHITE_RADIO)
     {
@@ -499,35 +892,10 @@ send_frame (int fd, uint8_t *frame, int count, op_mode_t type, uint8_t slot)
     if (type < ROTFUNK_PLUS)
     {
         *p++ = SOF_CHAR;
-        
-        for (i = 0; i < count; i++)
-        {
-            if (p < send_buffer + MAX_FRAME_LEN - 1)
-            {
-                switch (frame[i])
-                {
-                    case SOF_CHAR:
-                        *p++ = ESCAPE_CHAR;
-                        *p++ = 0;
-                        break;
-                        
-                    case EOF_CHAR:
-                        *p++ = ESCAPE_CHAR;
-                        *p++ = 1;
-                        break;
-                        
-                    case ESCAPE_CHAR:
-                        *p++ = ESCAPE_CHAR;
-                        *p++ = 2;
-                        break;
-                        
-                    default:
-                        *p++ = frame[i];
-                }
-            }
-        }
+        // keep the last byte for the EOF
+        p += codec_escape (p, dst + MAX_FRAME_LEN - 1 - p, frame, count);
         *p++ = EOF_CHAR;
-        count = (int) (p - send_buffer);
+        count = (int) (p - dst);
     }
     else
     {
@@ -539,36 +907,59 @@ send_frame (int fd, uint8_t *frame, int count, op_mode_t type, uint8_t slot)
     if (type > WHITE_RADIO)
     {
         // special handling of frames with header
-        send_buffer[0] = (type == WHITE_RADIO_PLUS ? SOH_CHAR : (count - sizeof (red_header_t)));
-        send_buffer[1] = 1;         // frame type (TBD)
-        send_buffer[2] = slot;      // slot number
+        dst[0] = (type == WHITE_RADIO_PLUS ? SOH_CHAR : (count - sizeof (red_header_t)));
+        dst[1] = 1;         // frame type (TBD)
+        dst[2] = slot;      // slot number
     }
     
 #if SERIAL_DEBUG == 1
-    fprintf (stdout, "sent %d bytes, ", count);
+    fprintf (stdout, "encoded %d bytes, ", count);
     for (int i = 0; i < count; i++)
     {
-        fprintf (stdout, "%02x ", send_buffer[i]);
+        fprintf (stdout, "%02x ", dst[i]);
     }
     fprintf (stdout, "\n");
 #endif
-    result = write (fd, send_buffer, count);
-    tcdrain (fd);           // wait for the transmission to finish
+    return count;
+}
+
+//  @brief Encode and write a frame; returns as soon as the driver has it.
+//  @retval number of bytes written, or -1 on errors.
+
+ssize_t
+send_frame (int fd, uint8_t *frame, int count, op_mode_t type, uint8_t slot)
+{
+    uint8_t send_buffer[MAX_FRAME_LEN];
     
-    return result;
+    count = (int) encode_frame (send_buffer, frame, count, type, slot);
+    return write (fd, send_buffer, count);
 }
 
+//  @brief Send a command to the radio module; the CMD/DATA line must frame
+//      exactly the command bytes, so the frames still in flight are let out
+//      first, and the command itself is waited for. Commands are rare, so
+//      this waits with tcdrain(), for the UART and USB bridge FIFOs too,
+//      which the driver queue depth used for the frames does not cover.
+//  @retval number of bytes written, or -1 on errors.
+
 ssize_t
-send_command (int fd, uint8_t *command, size_t cmd_len, size_t max_len)
+send_command (port_t *port, uint8_t *command, size_t cmd_len, size_t max_len)
 {
+    int fd = port->fd;
     ssize_t result;
     struct timespec sts;
     
     sts.tv_nsec = 500000;   // 500 us
     sts.tv_sec = 0;
     
+    tcdrain (fd);
+    tx_track_drain (&port->track, fd, port->baudrate);  // retires them all
     cmd_data(fd, false);    // cmd active
     result = write (fd, command, cmd_len);
+    if (result > 0)
+    {
+        capture_tx (port, CAPTURE_TX_CMD, command, result, monotonic_ns ());
+    }
     tcdrain (fd);           // wait for the transmission to finish
     nanosleep (&sts, NULL); // add some more delay
     cmd_data(fd, true);     // cmd inactive
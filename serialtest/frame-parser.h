@@ -29,17 +29,18 @@
 #define frame_parser_h
 
 #include <stdio.h>
+#include <stddef.h>
 #include <pthread.h>
 
 #include "utils.h"
 
-#define USE_IOSSIOSPEED true
-
 #define SOF_CHAR 0xf0   // start of frame
 #define EOF_CHAR 0xf1   // end of frame
 #define ESCAPE_CHAR 0xf2
 #define SOH_CHAR 0xf3   // start of header
 #define MAX_FRAME_LEN 240
+#define FRAME_SIZE_DEFAULT 22   // low latency frames, header included
+#define MAX_BURST 32    // frames sent with a single write
 
 typedef enum
 {
@@ -58,13 +59,73 @@ typedef struct __attribute__ ((packed))
     uint32_t timestamp;
 } frame_hdr_t;
 
+// frame_hdr_t.type carries a radio_cmds_t in the lower bits; when
+// FRAME_TYPE_EXT is set, a frame_ext_t follows the header
+#define FRAME_TYPE_MASK 0x7f
+#define FRAME_TYPE_EXT 0x80
+
+// version 2 added the sequence number; receivers go by len, so they read
+// what they know of newer extensions and tell the older ones apart
+#define FRAME_EXT_VERSION 2
+
+typedef struct __attribute__ ((packed))
+{
+    uint8_t version;
+    uint8_t len;            // extension length, these two bytes included
+    uint64_t timestamp;     // CLOCK_MONOTONIC at send time, ns
+    uint32_t seq;           // per sender, the index is its lower 8 bits
+} frame_ext_t;
+
+// shortest extension carrying field f
+#define FRAME_EXT_HAS(ext, f) \
+    ((ext)->len >= offsetof (frame_ext_t, f) + sizeof (((frame_ext_t *) 0)->f))
+
 typedef struct
 {
     frame_hdr_t header;
     uint8_t payload[];  // length is variable
 } frame_t;
 
-// interprocess communication structure
+typedef enum
+{
+    PARSER_IDLE = 0,    // hunting for a frame or header start
+    PARSER_HEADER,      // inside the 3 bytes White+ header
+    PARSER_FRAME,       // between SOF and EOF
+    PARSER_ESCAPE,      // an ESCAPE_CHAR was just seen
+    PARSER_RSSI,        // EOF seen, waiting for the White rssi byte
+} parser_state_t;
+
+// a received frame, as handed from the parsers to the analyzer; data points
+// either straight into the receive buffer or into the parser's scratch
+// buffer, and is only valid during the handler call
+typedef struct
+{
+    const uint8_t *data;
+    size_t len;
+    int8_t rssi;
+    uint64_t arrival;   // CLOCK_MONOTONIC, ns
+} frame_view_t;
+
+typedef void (*frame_handler_t) (void *arg, const frame_view_t *view);
+
+// streaming 0xf0/0xf1 parser context
+typedef struct
+{
+    parser_state_t state;
+    bool white_plus;
+    int8_t rssi;
+    uint8_t header_count;
+    size_t len;
+    uint8_t frame[MAX_FRAME_LEN];   // scratch for frames that need unescaping
+    uint64_t arrival;
+    frame_handler_t handler;
+    void *arg;
+} parser_ctx_t;
+
+#define IPC_TEXT_LEN 256
+
+// interprocess communication structure; a command message, passed by value
+// through the command queue
 typedef struct
 {
     int cmd;
@@ -72,7 +133,8 @@ typedef struct
     uint32_t parameter0;
     uint32_t parameter1;
     uint32_t parameter2;
-    char* text;
+    uint8_t text[IPC_TEXT_LEN];     // SEND_PLAIN_FRAME payload, parameter0 bytes
+    uint64_t issued;                // CLOCK_MONOTONIC when queued, ns
 } ipc_t;
 
 typedef enum
@@ -97,6 +159,10 @@ typedef enum
     SET_PROTOCOL,
     GET_TRAFFIC_STATS,
     GET_RED_TRAFFIC_STATS,
+    BURST,
+    SEND_PING_FRAMES,
+    SEND_PONG,
+    CLEAR_STATS,        // the TX statistics, cleared by the sender
 } serial_cmds_t;
 
 typedef enum
@@ -105,6 +171,8 @@ typedef enum
     FILE_XFER,
     SET_RADIO_CHANNEL,
     SET_RADIO_RATE,
+    PING,               // echoed as a PONG by a responder, payload ping_t
+    PONG,
     HIGHEST_CMD
 } radio_cmds_t;
 
@@ -121,11 +189,23 @@ parse_result_t
 parse_f0_f1_frames (uint8_t **buff, uint8_t **end, int8_t *rssi);
 
 void
-print_frames (uint8_t *buff, size_t len, int8_t rssi);
+parser_init (parser_ctx_t *ctx, frame_handler_t handler, void *arg);
+
+void
+parser_reset (parser_ctx_t *ctx);
+
+void
+parser_feed (parser_ctx_t *ctx, const uint8_t *buff, size_t len, uint64_t arrival);
+
+void
+print_frames (const uint8_t *buff, size_t len, int8_t rssi);
 
 void *
 send_frames (void *p);
 
+size_t
+encode_frame (uint8_t *dst, const uint8_t *frame, int count, op_mode_t type, uint8_t slot);
+
 ssize_t
 send_frame (int fd, uint8_t *frame, int count, op_mode_t type, uint8_t slot);
 
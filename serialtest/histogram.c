@@ -0,0 +1,223 @@
+//
+//  histogram.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "histogram.h"
+
+
+// Bucket of a value: values below HIST_SUB_COUNT map to themselves, above
+// that the leading one bit selects the range and the next HIST_SUB_BITS
+// bits the linear bucket within it.
+static inline unsigned
+hist_index (uint32_t value)
+{
+    int shift;
+    
+    if (value < HIST_SUB_COUNT)
+    {
+        return value;
+    }
+    shift = 31 - __builtin_clz (value) - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB_COUNT + ((value >> shift) & (HIST_SUB_COUNT - 1));
+}
+
+// Highest value that falls into a bucket.
+static uint32_t
+hist_bucket_max (unsigned index)
+{
+    unsigned shift;
+    uint64_t lowest;
+    
+    if (index < HIST_SUB_COUNT)
+    {
+        return index;
+    }
+    shift = index / HIST_SUB_COUNT - 1;
+    lowest = (uint64_t) (HIST_SUB_COUNT + index % HIST_SUB_COUNT) << shift;
+    return (uint32_t) (lowest + ((uint64_t) 1 << shift) - 1);
+}
+
+//  @brief Empty a histogram.
+
+void
+hist_reset (histogram_t *h)
+{
+    memset (h, 0, sizeof (histogram_t));
+    h->min = UINT32_MAX;
+}
+
+//  @brief Record a value; constant time, no allocation.
+
+void
+hist_record (histogram_t *h, uint32_t value)
+{
+    h->counts[hist_index (value)]++;
+    h->total++;
+    if (value < h->min)
+    {
+        h->min = value;
+    }
+    if (value > h->max)
+    {
+        h->max = value;
+    }
+}
+
+//  @brief Add the content of a histogram to another one.
+//  @param dst: destination histogram.
+//  @param src: source histogram, left unchanged.
+
+void
+hist_merge (histogram_t *dst, const histogram_t *src)
+{
+    if (src->total == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    if (src->min < dst->min)
+    {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+}
+
+//  @brief Compute a percentile.
+//  @param h: histogram.
+//  @param percentile: 0 to 100, e.g. 99.9.
+//  @retval the highest value of the bucket holding the percentile, bounded
+//      by the recorded min and max; 0 if the histogram is empty.
+
+uint32_t
+hist_percentile (const histogram_t *h, double percentile)
+{
+    uint64_t target, count = 0;
+    uint32_t value = h->max;
+    
+    if (h->total == 0)
+    {
+        return 0;
+    }
+    target = (uint64_t) (percentile * h->total / 100.0 + 0.5);
+    if (target == 0)
+    {
+        target = 1;
+    }
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        count += h->counts[i];
+        if (count >= target)
+        {
+            value = hist_bucket_max (i);
+            break;
+        }
+    }
+    if (value > h->max)
+    {
+        value = h->max;
+    }
+    if (value < h->min)
+    {
+        value = h->min;
+    }
+    return value;
+}
+
+//  @brief Save a histogram as text, only the non empty buckets.
+//  @param fp: output file.
+//  @param id: tag stored along, e.g. the node address.
+//  @param h: histogram.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+hist_write (FILE *fp, int id, const histogram_t *h)
+{
+    int buckets = 0;
+    
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        buckets += h->counts[i] != 0;
+    }
+    fprintf (fp, "hist %d %llu %u %u %d\n", id, (unsigned long long) h->total,
+             h->min, h->max, buckets);
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        if (h->counts[i])
+        {
+            fprintf (fp, "%d %u\n", i, h->counts[i]);
+        }
+    }
+    return ferror (fp) ? -1 : 0;
+}
+
+//  @brief Load a histogram saved by hist_write().
+//  @param fp: input file.
+//  @param id: the tag is returned here.
+//  @param h: histogram, overwritten.
+//  @retval 1 if a histogram was read, 0 at the end of file, -1 if malformed.
+
+int
+hist_read (FILE *fp, int *id, histogram_t *h)
+{
+    unsigned long long total;
+    unsigned index, count;
+    int buckets;
+    
+    hist_reset (h);
+    switch (fscanf (fp, " hist %d %llu %u %u %d", id, &total, &h->min, &h->max, &buckets))
+    {
+        case 5:
+            break;
+            
+        case EOF:
+            return 0;
+            
+        default:
+            return -1;
+    }
+    h->total = total;
+    while (buckets--)
+    {
+        if (fscanf (fp, "%u %u", &index, &count) != 2 || index >= HIST_BUCKETS)
+        {
+            return -1;
+        }
+        h->counts[index] = count;
+    }
+    return 1;
+}
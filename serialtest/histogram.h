@@ -0,0 +1,69 @@
+//
+//  histogram.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef histogram_h
+#define histogram_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Log-linear (HDR style) histogram of 32 bit values. Each power of two range
+// is split in HIST_SUB_COUNT linear buckets, so any recorded value is known
+// within 1/HIST_SUB_COUNT (about 3%) of its true value, at a fixed cost of
+// HIST_BUCKETS counters. Values below HIST_SUB_COUNT are exact.
+#define HIST_SUB_BITS   5
+#define HIST_SUB_COUNT  (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS    ((32 - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+typedef struct histogram_
+{
+    uint64_t total;
+    uint32_t min;
+    uint32_t max;
+    uint32_t counts[HIST_BUCKETS];
+} histogram_t;
+
+void
+hist_reset (histogram_t *h);
+
+void
+hist_record (histogram_t *h, uint32_t value);
+
+void
+hist_merge (histogram_t *dst, const histogram_t *src);
+
+uint32_t
+hist_percentile (const histogram_t *h, double percentile);
+
+int
+hist_write (FILE *fp, int id, const histogram_t *h);
+
+int
+hist_read (FILE *fp, int *id, histogram_t *h);
+
+#endif /* histogram_h */
@@ -33,29 +33,35 @@
 #include <string.h>
 #include <stdlib.h>
 #include <termios.h>
-#include <fcntl.h>
-#include <sys/_select.h>
-#include <sys/ioctl.h>
-#include <IOKit/serial/ioss.h>
+#include <time.h>
+#include <signal.h>
 #include <pthread.h>
 
 #include "frame-parser.h"
 #include "cli.h"
 #include "utils.h"
-#include "statistics.h"
-
-
-#define SERIAL_DEBUG 0
+#include "serial.h"
+#include "port.h"
+#include "capture.h"
+#include "replay.h"
 
 
 void
 quit (void);
 
-static int
-handle_serial_line (int fd, bool print);
+static void *
+wait_interrupt (void *arg);
+
+static void
+stop_capture (void);
+
+static void
+save_series (void);
 
 static int
-locate_port (char *location, char* path, size_t len);
+run_replay (const char *path, bool paced);
+
+static char *series_file;   // time series saved on the way out
 
 
 
@@ -65,24 +71,48 @@ int
 main (int argc, char * argv[])
 {
     int ch;
-    char *port = NULL;
-    char *address = NULL;
-    int fd;
+    char *ports[MAX_PORTS];
+    char *locations[MAX_PORTS];
+    int port_count = 0;
+    int location_count = 0;
+    int cpus[MAX_PORTS];
+    int cpu_count = 0;
     struct termios options;
     int baudRate = 115200;
+    char *capture_file = NULL;
+    char *replay_file = NULL;
+    bool paced = false;
+    sigset_t sigint;
+    pthread_t sig_thread;
     
-    signal (SIGINT, (void *) quit);	/* trap ctrl-c calls here */
+    // ctrl-c is taken by a thread of its own, out of any signal handler:
+    // the exit handlers take locks the interrupted thread could hold, so
+    // SIGINT stays blocked in every other thread (the mask is inherited)
+    sigemptyset (&sigint);
+    sigaddset (&sigint, SIGINT);
+    pthread_sigmask (SIG_BLOCK, &sigint, NULL);
+    if (pthread_create (&sig_thread, NULL, wait_interrupt, &sigint))
+    {
+        fprintf (stdout, "Error creating thread\n");
+        exit (EXIT_FAILURE);
+    }
     
-    while ((ch = getopt (argc, argv, "hvD:l:b:a:")) != -1)
+    while ((ch = getopt (argc, argv, "hvxPD:l:b:a:c:w:r:S:")) != -1)
     {
         switch (ch)
         {
             case 'D':
-                port = optarg;
+                if (port_count < MAX_PORTS)
+                {
+                    ports[port_count++] = optarg;
+                }
                 break;
                 
             case 'l':
-                address = optarg;
+                if (location_count < MAX_PORTS)
+                {
+                    locations[location_count++] = optarg;
+                }
                 break;
                 
             case 'b':
@@ -93,6 +123,34 @@ main (int argc, char * argv[])
                 own_address (SET_PARAMETER, atoi (optarg));
                 break;
                 
+            case 'c':
+                for (char *p = strtok (optarg, ","); p && cpu_count < MAX_PORTS; p = strtok (NULL, ","))
+                {
+                    cpus[cpu_count++] = atoi (p);
+                }
+                break;
+                
+            case 'w':
+                capture_file = optarg;
+                break;
+                
+            case 'r':
+                replay_file = optarg;
+                break;
+                
+            case 'P':
+                paced = true;
+                break;
+                
+            case 'S':
+                series_file = optarg;
+                record_series (SET_PARAMETER, SERIES_INTERVAL_MS);
+                break;
+                
+            case 'x':
+                ext_header (SET_PARAMETER, true);
+                break;
+                
             case 'v':
                 getver (0, NULL);
                 exit (EXIT_SUCCESS);
@@ -100,61 +158,48 @@ main (int argc, char * argv[])
                 
             case 'h':
             default:
-                fprintf (stdout, "Usage: serialtest -D <tty>\n\tor serialtest -l <usb_location_ID>\n");
-                fprintf (stdout, "\tother options: -b <baudrate>, -a <own_address>, -v, -h\n");
+                fprintf (stdout, "Usage: serialtest -D <tty> [-D <tty>...]\n\tor serialtest -l <usb_location_ID> [-l <usb_location_ID>...]\n"
+                         "\tor serialtest -r <capture_file> [-P] (replay, -P at the recorded pace)\n");
+                fprintf (stdout, "\tother options: -b <baudrate>, -a <own_address>, -c <cpu>[,<cpu>...],\n"
+                         "\t-x (64 bit timestamps), -w <capture_file>, -S <series_file> (1 s time series, CSV),\n"
+                         "\t-v, -h\n"
+                         "\tport n uses own_address + n and runs on the n-th cpu given\n");
                 exit (EXIT_SUCCESS);
                 break;
         }
     }
     
-    char buff[200];
-    if (address != NULL)
+    if (replay_file)
+    {
+        exit (run_replay (replay_file, paced) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    
+    static char buff[MAX_PORTS][200];
+    for (int i = 0; i < location_count && port_count < MAX_PORTS; i++)
     {
-        if (locate_port (address, buff, sizeof (buff)) == true)
+        if (serial_locate_port (locations[i], buff[i], sizeof (buff[i])) == true)
+        {
+            ports[port_count++] = buff[i];
+        }
+        else
         {
-            port = buff;
+            fprintf (stdout, "No device at location %s\n", locations[i]);
         }
     }
     
-    if (port == NULL)
+    if (port_count == 0)
     {
-        fprintf (stdout, "Missing device (-D or -p option required)\n");
+        fprintf (stdout, "Missing device (-D or -l option required)\n");
         exit (EXIT_FAILURE);
     }
     
-    fd = open(port, O_RDWR | O_NOCTTY | O_NDELAY);
-    if (fd != -1)
+    for (int i = 0; i < port_count; i++)
     {
-        fcntl (fd, F_SETFL, 0);
-        tcgetattr (fd, &options);
-#if USE_IOSSIOSPEED == false
-        cfsetispeed (&options, baudRate);
-        cfsetospeed (&options, baudRate);
-#endif
-        options.c_cflag |= (CLOCAL | CREAD);
-        options.c_oflag &= ~OPOST;
-        options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
-        
-        options.c_cc[VTIME] = 0;
-        options.c_cc[VMIN] = 1;
-        options.c_cc[VERASE] = 8;
-        if (tcsetattr (fd, TCSANOW, &options) < 0)
+        if (port_open (ports[i], baudRate, own_address (GET_PARAMETER, 0) + i,
+                       i < cpu_count ? cpus[i] : -1) == NULL)
         {
-            fprintf (stdout, "Failed to set new parameters on the serial port\n");
             exit (EXIT_FAILURE);
         }
-#if USE_IOSSIOSPEED == true
-        speed_t speed = baudRate;
-        if (ioctl(fd, IOSSIOSPEED, &speed) == -1 )
-        {
-            fprintf (stdout, "Failed to set new baudrate\n");
-        }
-#endif
-    }
-    else
-    {
-        fprintf (stdout, "Failed to open serial device %s\n", port);
-        exit (EXIT_FAILURE);
     }
     
     // set proper backspace character
@@ -164,316 +209,110 @@ main (int argc, char * argv[])
     {
         fprintf (stdout, "Failed to set erase character on stdin\n");
     }
-    set_serial_fd (fd);
+    // unbuffered, so each line is handled as it arrives
+    setvbuf (stdin, NULL, _IONBF, 0);
     
-    clear_stats (); // clear all statistic data
-    
-    pthread_t thread;
-    
-    // create a  thread for sending frames over the serial port
-    if (pthread_create (&thread, NULL, send_frames, (void *) &fd))
+    if (capture_file)
     {
-        fprintf(stdout, "Error creating thread\n");
-        exit (EXIT_FAILURE);
+        if ((g_capture = capture_open (capture_file)) == NULL)
+        {
+            fprintf (stdout, "Could not start the capture\n");
+            exit (EXIT_FAILURE);
+        }
     }
+    atexit (stop_capture);
+    atexit (save_series);
     
-    // prepare for multiple input sources
-    size_t res;
-    fd_set readfs;
-    int maxfd = fd + 1;
-    
-    do
+    // one receive and one sender thread per port
+    for (int i = 0; i < g_port_count; i++)
     {
-        FD_SET (fd, &readfs);
-        FD_SET (fileno (stdin), &readfs);
-        
-        res = select (maxfd, &readfs, NULL, NULL, NULL);
-        if (FD_ISSET(fd, &readfs))
+        if (port_start (g_ports[i]) < 0)
         {
-            // got a frame from serial
-            res = handle_serial_line (fd, dump_frames (GET_PARAMETER, false));
+            fprintf(stdout, "Error creating thread\n");
+            exit (EXIT_FAILURE);
         }
-        else if (FD_ISSET(fileno (stdin), &readfs))
+    }
+    
+    // the main thread is left with the user input
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    
+    while ((len = getline (&line, &size, stdin)) > 0)
+    {
+        if (parse_line (line, len) < 0)
         {
-            // got a line from the user
-            char *line = NULL;
-            size_t size = 0;
-            
-            if ((res = getline (&line, &size, stdin)) > 0)
-            {
-                if (parse_line (line, res) < 0)
-                {
-                    // quit command
-                    res = 1;
-                }
-                else
-                {
-                    res = 0;
-                }
-                free (line);
-                fprintf (stdout, "> ");
-                fflush (stdout);
-            }
+            break;  // quit command
         }
-    } while (res == 0);
+        fprintf (stdout, "> ");
+        fflush (stdout);
+    }
+    free (line);
     
     return EXIT_SUCCESS;
 }
 
-// @brief   Handle serial port input frames.
-// @param   fd: serial file descriptor.
-// @retval  0 if successful, 1 if serial port error.
+void
+quit (void)
+{
+    exit (1);
+}
 
-static int
-handle_serial_line (int fd, bool print)
+// Wait for ctrl-c, then quit like the quit command.
+static void *
+wait_interrupt (void *arg)
 {
-    ssize_t res;
-    static uint8_t buff[400];
-    static ssize_t offset = 0;
-    int8_t rssi;
-    struct timespec tp;
-    static long last_entry = 0;
-    
-    clock_gettime (CLOCK_MONOTONIC, &tp);
-    long tmp = tp.tv_nsec / 1000;
-    long diff = tmp - last_entry;
-    if (diff > 2000)    // 2 ms
-    {
-        offset = 0;
-#if SERIAL_DEBUG == 1
-        fprintf (stdout, "----\n");
-#endif
-    }
-    last_entry = tmp;
+    int sig;
     
-    if ((res = read (fd, buff + offset, sizeof (buff) - offset)) > 0)
-    {
-#if SERIAL_DEBUG == 1
-        fprintf (stdout, "\n%ld: read %ld bytes, offset %ld\n", offset ? diff : tmp, res, offset);
-        for (int i = 0; i < res; i++)
-        {
-            fprintf (stdout, "%02x ", (buff + offset)[i]);
-        }
-        fprintf (stdout, "\n");
-#endif
-        uint8_t *begin, *end;
-        int result;
-        
-        begin = buff;
-        end = buff + res + offset - 1;
-        
-        op_mode_t mode = get_mode ();
-        if (mode == WHITE_RADIO || mode == WHITE_RADIO_PLUS)
-        {
-            while ((result = parse_f0_f1_frames (&begin, &end, &rssi)) == FRAME_OK)
-            {
-                if (print)
-                {
-                    print_frames (begin, end - begin + 1, rssi);
-                }
-                
-                int count = extract_f0_f1_frame (begin, end - begin + 1);
-                if (count > 0)
-                {
-                    analyzer (begin, count - 1, rssi);
-                }
-                if (end < buff + res + offset) // whole buffer done?
-                {
-                    // no, we might have more frames here, or at least a truncated one
-                    begin = end + 1;
-                    end = buff + res + offset - 1;
-                }
-                else
-                {
-                    offset = 0;
-                    break;
-                }
-            }
-            
-            if (result == FRAME_TRUNCATED)
-            {
-                // that means we have detected a frame begin, but not an end
-#if SERIAL_DEBUG == 1
-                fprintf (stdout, "-- truncated (len %ld)\n", end - begin + 1);
-#endif
-                // prepare to read more data from the serial port
-                memmove (buff, begin, end - begin + 1);
-                offset = end - begin + 1;
-            }
-            else
-            {
-                offset = 0;
-            }
-        }
-        else if (mode == ROTFUNK_PLUS)
-        {
-            // rot funk plus
-#if SERIAL_DEBUG == 1
-            fprintf (stdout, "count %ld, header %lu\n", res + offset, buff[0] + sizeof (red_header_t));
-#endif
-            if (buff[0] == 0xCC && res + offset >= 3)
-            {
-                // get rid of 0xCC answers
-                offset = 0;
-            }
-            else if ((res + offset) == (buff[0] + sizeof (red_header_t)))
-            {
-                // frame complete
-                size_t payload_len = buff[0];
-                uint8_t* p = &buff[3];
-                
-                if (print)
-                {
-                    print_frames (p, payload_len, buff[2]);
-                }
-                if (payload_len)
-                {
-                    analyzer (p, payload_len, buff[2]);
-                }
-                offset = 0;
-            }
-            else
-            {
-                offset += res;
-                if (offset >= sizeof (buff))
-                {
-                    offset = 0;
-                }
-            }
-        }
-        else if (mode == PLAIN)
-        {
-            fprintf (stdout, "read %ld bytes, offset %ld\n", res, offset);
-            for (int i = 0; i < res; i++)
-            {
-                fprintf (stdout, "%02x ", (buff + offset)[i]);
-            }
-            fprintf (stdout, "\n");
-        }
-        return 0;
-    }
-    else
-    {
-        perror("serial port read");
-        return 1;
-    }
+    sigwait ((const sigset_t *) arg, &sig);
+    quit ();
+    return NULL;
 }
 
-#include <CoreFoundation/CoreFoundation.h>
-#include <IOKit/IOKitLib.h>
-#include <IOKit/usb/IOUSBLib.h>
-#include <IOKit/IOBSD.h>
-#include <IOKit/IOMessage.h>
-#include <IOKit/serial/ioss.h>
-
+// Replay a capture and show the statistics of each of its ports.
 static int
-locate_port (char *location, char* path, size_t len)
+run_replay (const char *path, bool paced)
 {
-    CFMutableDictionaryRef matchingDict;
-    io_iterator_t iter;
-    kern_return_t kr;
-    io_service_t device;
-    IOCFPlugInInterface **plugInInterface = NULL;
-    IOUSBDeviceInterface **dev = NULL;
-    SInt32 score;
-    ULONG result;
-    UInt16 vendor;
-    UInt16 product;
-    UInt16 address;
-    int res = false;
-    uint32_t find_location;
-    
-    sscanf (location, "%x", &find_location);
+    char line[16];
     
-    /* set up a matching dictionary for the class */
-    matchingDict = IOServiceMatching(kIOUSBDeviceClassName);
-    if (matchingDict == NULL)
+    if (replay_capture (path, paced) < 0)
     {
-        return -1; // fail
+        return -1;
     }
-    
-    /* Now we have a dictionary, get an iterator.*/
-    kr = IOServiceGetMatchingServices(kIOMasterPortDefault, matchingDict, &iter);
-    if (kr != KERN_SUCCESS)
+    for (int i = 0; i < g_port_count; i++)
     {
-        return -1;
+        fprintf (stdout, "Port %d (%s):\n", i, g_ports[i]->path);
+        port_select (i);
+        strcpy (line, "stat\n");
+        parse_line (line, strlen (line));
     }
-    
-    /* iterate */
-    while ((device = IOIteratorNext(iter)))
+    if (g_port_count > 1)
     {
-        // Create an intermediate plug-in
-        kr = IOCreatePlugInInterfaceForService(device,
-                                               kIOUSBDeviceUserClientTypeID, kIOCFPlugInInterfaceID,
-                                               &plugInInterface, &score);
-        // Don’t need the device object after intermediate plug-in is created
-        if ((kIOReturnSuccess != kr) || !plugInInterface)
-        {
-            fprintf(stdout, "Unable to create a plug-in (%08x)\n", kr);
-            continue;
-        }
-        
-        // Now create the device interface
-        result = (*plugInInterface)->QueryInterface(plugInInterface,
-                                                    // CFUUIDGetUUIDBytes(kIOUSBDeviceInterfaceID),
-                                                    // this is for macos 10.13
-                                                    CFUUIDGetUUIDBytes(kIOUSBDeviceInterfaceID650),
-                                                    (LPVOID *)&dev);
-        
-        // Don’t need the intermediate plug-in after device interface is created
-        (*plugInInterface)->Release(plugInInterface);
-        
-        if (result || !dev)
-        {
-            fprintf(stdout, "Couldn’t create a device interface (%08x)\n", (int) result);
-            continue;
-        }
-        
-        uint32_t locationID;
-        
-        kr = (*dev)->GetDeviceVendor(dev, &vendor);
-        kr = (*dev)->GetDeviceProduct(dev, &product);
-        kr = (*dev)->GetDeviceAddress (dev, &address);
-        kr = (*dev)->GetLocationID(dev, &locationID);
-        
-        if ((vendor != 0x10c4) || (product != 0xea60))
-        {
-            // we look for Silicon Labs CP2102 chips only
-            (void) (*dev)->Release(dev);
-            continue;
-        }
-        
-        if (locationID == find_location)
-        {
-            CFStringRef deviceBSDName_cf;
-            deviceBSDName_cf = (CFStringRef) IORegistryEntrySearchCFProperty (device,
-                                                                              kIOServicePlane,
-                                                                              CFSTR (kIOCalloutDeviceKey),
-                                                                              kCFAllocatorDefault,
-                                                                              kIORegistryIterateRecursively);
-            result = CFStringGetCString(deviceBSDName_cf,
-                                        path,
-                                        len,
-                                        kCFStringEncodingUTF8);
-            
-            (void) (*dev)->Release(dev);
-            IOObjectRelease(device);
-            res = true;
-            break;
-        }
-        
-        (void) (*dev)->Release(dev);
-        IOObjectRelease(device);
+        strcpy (line, "stat all\n");
+        parse_line (line, strlen (line));
     }
+    save_series ();
+    return 0;
+}
+
+// Save the rest of the capture on the way out.
+static void
+stop_capture (void)
+{
+    capture_t *cap = __atomic_exchange_n (&g_capture, NULL, __ATOMIC_ACQ_REL);
     
-    /* Done, release the iterator */
-    IOObjectRelease(iter);
-    
-    return res;
+    capture_close (cap);
 }
 
-void
-quit (void)
+// Save the time series asked for with -S.
+static void
+save_series (void)
 {
-    exit (1);
+    char line[300];
+    
+    if (series_file)
+    {
+        snprintf (line, sizeof (line), "series save %s\n", series_file);
+        parse_line (line, strlen (line));
+    }
 }
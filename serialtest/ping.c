@@ -0,0 +1,203 @@
+//
+//  ping.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ping.h"
+#include "seqlock.h"
+
+#define PING_PENDING 1ULL
+
+
+//  @brief Initialize a ping table, nothing in flight.
+
+void
+ping_init (ping_table_t *t)
+{
+    memset (t, 0, sizeof (ping_table_t));
+    t->next_seq = 1;    // an all zero tag would match sequence 0
+    hist_reset (&t->tx.turnaround);
+    hist_reset (&t->rx.rtt);
+}
+
+//  @brief Sender side: take the next sequence number and mark it pending.
+//  @retval the sequence number to put in the ping.
+
+uint32_t
+ping_issue (ping_table_t *t)
+{
+    uint32_t seq = t->next_seq++;
+    uint64_t *slot = &t->tag[seq & (PING_TABLE_SIZE - 1)];
+    uint64_t old = __atomic_load_n (slot, __ATOMIC_ACQUIRE);
+    
+    seqlock_write_begin (&t->tx.lock);
+    // still waiting for the ping sent a table ago: it is lost, unless
+    // the answer comes in right now
+    if ((old & PING_PENDING) &&
+        __atomic_compare_exchange_n (slot, &old, old & ~PING_PENDING, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        t->tx.lost++;
+    }
+    __atomic_store_n (slot, ((uint64_t) seq << 1) | PING_PENDING, __ATOMIC_RELEASE);
+    t->tx.sent++;
+    seqlock_write_end (&t->tx.lock);
+    return seq;
+}
+
+//  @brief Sender side: record the time from a ping in to its pong written.
+
+void
+ping_turnaround (ping_table_t *t, uint64_t us)
+{
+    seqlock_write_begin (&t->tx.lock);
+    hist_record (&t->tx.turnaround, us > UINT32_MAX ? UINT32_MAX : (uint32_t) us);
+    seqlock_write_end (&t->tx.lock);
+}
+
+//  @brief Sender side: reset its counters; the pings in flight stay
+//      matchable.
+
+void
+ping_clear_tx (ping_table_t *t)
+{
+    seqlock_write_begin (&t->tx.lock);
+    t->tx.sent = t->tx.lost = 0;
+    hist_reset (&t->tx.turnaround);
+    seqlock_write_end (&t->tx.lock);
+}
+
+//  @brief RX side: match an answer with its ping.
+//  @param t: ping table.
+//  @param pong: the payload of the PONG frame.
+//  @param now: arrival time (CLOCK_MONOTONIC, ns).
+
+void
+ping_answer (ping_table_t *t, const ping_t *pong, uint64_t now)
+{
+    uint64_t *slot = &t->tag[pong->seq & (PING_TABLE_SIZE - 1)];
+    uint64_t expected = ((uint64_t) pong->seq << 1) | PING_PENDING;
+    uint64_t old = expected;
+    
+    ping_poll (t);
+    seqlock_write_begin (&t->rx.lock);
+    if (__atomic_compare_exchange_n (slot, &old, expected & ~PING_PENDING, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        uint64_t rtt = now > pong->sent ? (now - pong->sent) / 1000 : 0;
+        hist_record (&t->rx.rtt, rtt > UINT32_MAX ? UINT32_MAX : (uint32_t) rtt);
+        t->rx.answered++;
+    }
+    else if (old == (expected & ~PING_PENDING))
+    {
+        t->rx.duplicates++;
+    }
+    else if ((int32_t) (pong->seq - (uint32_t) (old >> 1)) < 0)
+    {
+        t->rx.late++;   // the slot was reused meanwhile
+    }
+    else
+    {
+        t->rx.unmatched++;
+    }
+    seqlock_write_end (&t->rx.lock);
+}
+
+//  @brief RX side, responder: count a ping handed to the sender to be
+//      echoed, or dropped when its queue was full.
+
+void
+ping_echo (ping_table_t *t, bool queued)
+{
+    ping_poll (t);
+    seqlock_write_begin (&t->rx.lock);
+    if (queued)
+    {
+        t->rx.echoed++;
+    }
+    else
+    {
+        t->rx.echo_dropped++;
+    }
+    seqlock_write_end (&t->rx.lock);
+}
+
+//  @brief Ask the RX thread to reset its counters.
+
+void
+ping_clear_request (ping_table_t *t)
+{
+    __atomic_store_n (&t->clear_rx, true, __ATOMIC_RELEASE);
+}
+
+//  @brief Check whether the last clear request was carried out.
+
+bool
+ping_clear_done (const ping_table_t *t)
+{
+    return !__atomic_load_n (&t->clear_rx, __ATOMIC_ACQUIRE);
+}
+
+//  @brief RX side: carry out a pending clear request; called before every
+//      update and every now and then.
+
+void
+ping_poll (ping_table_t *t)
+{
+    if (!__atomic_load_n (&t->clear_rx, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    seqlock_write_begin (&t->rx.lock);
+    t->rx.answered = t->rx.late = t->rx.duplicates = t->rx.unmatched = 0;
+    t->rx.echoed = t->rx.echo_dropped = 0;
+    hist_reset (&t->rx.rtt);
+    seqlock_write_end (&t->rx.lock);
+    __atomic_store_n (&t->clear_rx, false, __ATOMIC_RELEASE);
+}
+
+//  @brief Consistent copies of the counters of both threads, from any
+//      thread.
+
+void
+ping_snapshot (const ping_table_t *t, ping_tx_stats_t *tx, ping_rx_stats_t *rx)
+{
+    seqlock_read (&t->tx.lock, tx, &t->tx, sizeof (ping_tx_stats_t));
+    seqlock_read (&t->rx.lock, rx, &t->rx, sizeof (ping_rx_stats_t));
+}
+
+//  @brief Pings neither answered nor declared lost yet.
+
+uint64_t
+ping_in_flight (const ping_tx_stats_t *tx, const ping_rx_stats_t *rx)
+{
+    uint64_t done = rx->answered + tx->lost;
+    
+    return tx->sent > done ? tx->sent - done : 0;
+}
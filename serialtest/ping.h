@@ -0,0 +1,127 @@
+//
+//  ping.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef ping_h
+#define ping_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "histogram.h"
+
+#define PING_TABLE_SIZE 4096    // pings in flight, a power of two
+
+// payload of the PING frames, echoed unchanged in the PONG frames; the
+// send time is read back by the originator only, so RTTs need one clock
+typedef struct __attribute__ ((packed))
+{
+    uint32_t seq;
+    uint64_t sent;      // originator's CLOCK_MONOTONIC, ns
+} ping_t;
+
+// payload of the PONG frames: the ping, and the responder's clock when the
+// ping came in and when the pong went out, for the clock estimates
+typedef struct __attribute__ ((packed))
+{
+    ping_t ping;
+    uint64_t received;  // responder's CLOCK_MONOTONIC, ns
+    uint64_t replied;
+} pong_t;
+
+// counters of the sender thread, behind a seqlock
+typedef struct
+{
+    uint32_t lock;
+    uint64_t sent;
+    uint64_t lost;
+    histogram_t turnaround; // responder side: ping in to pong written, us
+} ping_tx_stats_t;
+
+// and of the RX thread
+typedef struct
+{
+    uint32_t lock;
+    uint64_t answered;
+    uint64_t late;          // answered after being declared lost
+    uint64_t duplicates;
+    uint64_t unmatched;     // never sent by us
+    histogram_t rtt;        // us
+    uint64_t echoed;        // responder side: pings answered
+    uint64_t echo_dropped;  // and not answered, the sender being too busy
+} ping_rx_stats_t;
+
+// Pings in flight, matched by sequence number. Each slot holds the tag
+// (seq << 1) | pending of the last ping sent through it; the sender thread
+// fills slots, the RX thread answers them, and both go through atomic
+// operations on the tag, so an answer is counted once, even racing with
+// the reuse of its slot. A slot reused while still pending means the ping
+// was lost. Each thread clears its own counters, the RX thread when asked
+// to with ping_clear_request().
+typedef struct
+{
+    uint64_t tag[PING_TABLE_SIZE];
+    uint32_t next_seq;      // sender thread
+    ping_tx_stats_t tx;
+    ping_rx_stats_t rx;
+    bool clear_rx;          // request to the RX thread
+} ping_table_t;
+
+void
+ping_init (ping_table_t *t);
+
+uint32_t
+ping_issue (ping_table_t *t);
+
+void
+ping_turnaround (ping_table_t *t, uint64_t us);
+
+void
+ping_clear_tx (ping_table_t *t);
+
+void
+ping_answer (ping_table_t *t, const ping_t *pong, uint64_t now);
+
+void
+ping_echo (ping_table_t *t, bool queued);
+
+void
+ping_clear_request (ping_table_t *t);
+
+bool
+ping_clear_done (const ping_table_t *t);
+
+void
+ping_poll (ping_table_t *t);
+
+void
+ping_snapshot (const ping_table_t *t, ping_tx_stats_t *tx, ping_rx_stats_t *rx);
+
+uint64_t
+ping_in_flight (const ping_tx_stats_t *tx, const ping_rx_stats_t *rx);
+
+#endif /* ping_h */
@@ -0,0 +1,671 @@
+//
+//  port.c
+//  serialtest
+//
+//  Copyright (c) 2017 - 2021 Lix N. Paulian (lix@paulian.net)
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#if defined (__linux__)
+#define _GNU_SOURCE     // pthread_setaffinity_np()
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined (__linux__)
+#include <sched.h>
+#elif defined (__APPLE__)
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#endif
+
+#include "port.h"
+#include "seqlock.h"
+#include "serial.h"
+#include "capture.h"
+
+#define SERIAL_DEBUG 0
+#define RX_RING_SIZE (16 * 1024)  // room for several 4 KB reads
+
+// RX thread event sources
+enum
+{
+    EV_SERIAL,
+    EV_RX_GAP,
+    EV_TICK,
+};
+
+port_t *g_ports[MAX_PORTS];
+int g_port_count;
+
+static int current_port;
+
+static void
+handle_f0_f1_frame (void *arg, const frame_view_t *view);
+
+static void
+handle_ping_frame (void *arg, const frame_t *frame, uint64_t arrival);
+
+
+// Allocate a port and set up everything but the serial line.
+static port_t *
+port_alloc (const char *path, int baudrate, uint8_t address, int cpu)
+{
+    port_t *port;
+    
+    if (g_port_count == MAX_PORTS)
+    {
+        fprintf (stdout, "Too many ports (max %d)\n", MAX_PORTS);
+        return NULL;
+    }
+    if ((port = calloc (1, sizeof (port_t))) == NULL)
+    {
+        return NULL;
+    }
+    port->id = g_port_count;
+    snprintf (port->path, sizeof (port->path), "%s", path);
+    port->fd = -1;
+    port->cpu = cpu;
+    port->baudrate = baudrate;
+    port->address = address;
+    port->mode = PLAIN;
+    port->frame_size = FRAME_SIZE_DEFAULT;
+    port->burst = 1;
+    port->interval = TX_PERIOD_DEFAULT_US;
+    
+    if (ring_init (&port->rx_ring, RX_RING_SIZE, true) < 0 ||
+        tx_sched_init (&port->sched, TX_PERIOD_DEFAULT_US) < 0 ||
+        (port->series = series_alloc ()) == NULL)
+    {
+        fprintf (stdout, "Failed to set up port %s\n", path);
+        free (port);
+        return NULL;
+    }
+    parser_init (&port->parser, handle_f0_f1_frame, port);
+    clear_stats (&port->stats);
+    cmd_queue_init (&port->queue);
+    tx_track_init (&port->track);
+    ping_init (&port->ping);
+    if (record_series (GET_PARAMETER, 0))
+    {
+        series_start (port->series, record_series (GET_PARAMETER, 0));
+    }
+    
+    g_ports[g_port_count++] = port;
+    return port;
+}
+
+//  @brief Open a serial port and set up everything needed to drive it.
+//  @param path: device path.
+//  @param baudrate: serial baud rate.
+//  @param address: own node address on this port.
+//  @param cpu: CPU to run the port threads on, -1 for any.
+//  @retval the port, or NULL on errors (reported on the console).
+
+port_t *
+port_open (const char *path, int baudrate, uint8_t address, int cpu)
+{
+    port_t *port;
+    int fd;
+    
+    fd = serial_open (path, baudrate);
+    if (fd == -1)
+    {
+        fprintf (stdout, "Failed to open serial device %s\n", path);
+        return NULL;
+    }
+    if ((port = port_alloc (path, baudrate, address, cpu)) == NULL)
+    {
+        close (fd);
+        return NULL;
+    }
+    port->fd = fd;
+    return port;
+}
+
+//  @brief Set up a port with no serial line behind it, to be given data
+//      with port_feed(); no threads are started for it.
+//  @param name: shown instead of the device path.
+//  @param address: own node address on this port.
+//  @retval the port, or NULL on errors (reported on the console).
+
+port_t *
+port_offline (const char *name, uint8_t address)
+{
+    return port_alloc (name, 0, address, -1);
+}
+
+// Pin a thread to a CPU; on macOS only a hint, threads with the same
+// affinity tag are kept on the same L2 cache.
+static void
+port_set_affinity (pthread_t thread, int cpu)
+{
+#if defined (__linux__)
+    cpu_set_t set;
+    
+    CPU_ZERO (&set);
+    CPU_SET (cpu, &set);
+    if (pthread_setaffinity_np (thread, sizeof (set), &set))
+    {
+        fprintf (stdout, "Failed to set the affinity to CPU %d\n", cpu);
+    }
+#elif defined (__APPLE__)
+    thread_affinity_policy_data_t policy = { cpu + 1 };
+    
+    thread_policy_set (pthread_mach_thread_np (thread), THREAD_AFFINITY_POLICY,
+                       (thread_policy_t) &policy, THREAD_AFFINITY_POLICY_COUNT);
+#endif
+}
+
+// @brief   Consume all complete Rotfunk+ frames waiting in the receive ring;
+//          an incomplete one stays there until more data arrives.
+// @param   port: the port the data came in on.
+// @param   print: dump the frames to the console.
+// @param   arrival: when the last bytes were received (CLOCK_MONOTONIC, ns).
+
+static void
+handle_red_frames (port_t *port, bool print, uint64_t arrival)
+{
+    uint8_t frame[255 + sizeof (red_header_t)];
+    ring_buffer_t *rx_ring = &port->rx_ring;
+    const uint8_t *p;
+    size_t len;
+    
+    for (p = ring_read_ptr (rx_ring, &len); len > 0; p = ring_read_ptr (rx_ring, &len))
+    {
+        size_t used = ring_used (rx_ring);
+        size_t frame_len = p[0] + sizeof (red_header_t);
+        
+#if SERIAL_DEBUG == 1
+        fprintf (stdout, "count %lu, header %lu\n", used, frame_len);
+#endif
+        if (p[0] == 0xCC)
+        {
+            if (used < 3)
+            {
+                break;
+            }
+            // get rid of 0xCC answers
+            ring_flush (rx_ring);
+            break;
+        }
+        if (used < frame_len)
+        {
+            break;  // wait for the rest of the frame
+        }
+        if (len < frame_len)
+        {
+            // the frame wraps around the end of a plain (not mirrored) ring
+            memcpy (frame, p, len);
+            memcpy (frame + len, rx_ring->data, frame_len - len);
+            p = frame;
+        }
+        
+        // frame complete, analyze it where it is
+        frame_view_t view;
+        view.data = p + sizeof (red_header_t);
+        view.len = p[0];
+        view.rssi = p[2];
+        view.arrival = arrival;
+        if (print)
+        {
+            print_frames (view.data, view.len, view.rssi);
+        }
+        if (view.len)
+        {
+            analyzer (&port->stats, port->address, &view, handle_ping_frame, port);
+        }
+        ring_consume (rx_ring, frame_len);
+    }
+}
+
+// @brief   Called by the analyzer for the pings and pongs addressed to us; a
+//          ping is handed to the sender to be echoed at once, without ever
+//          blocking the receive thread, a pong is matched with its ping.
+// @param   arg: the port the frame came in on.
+// @param   frame: the frame, CRC checked.
+// @param   arrival: when it was received (CLOCK_MONOTONIC, ns).
+
+static void
+handle_ping_frame (void *arg, const frame_t *frame, uint64_t arrival)
+{
+    port_t *port = arg;
+    pong_t pong;
+    
+    if (frame->header.len < sizeof (frame_hdr_t) + sizeof (ping_t))
+    {
+        return;
+    }
+    memcpy (&pong.ping, frame->payload, sizeof (ping_t));
+    
+    if ((frame->header.type & FRAME_TYPE_MASK) == PONG)
+    {
+        ping_answer (&port->ping, &pong.ping, arrival);
+        // responders that don't stamp their pongs give no clock samples
+        if (frame->header.len >= sizeof (frame_hdr_t) + sizeof (pong_t))
+        {
+            memcpy (&pong, frame->payload, sizeof (pong));
+            clock_est_sample (&port->stats.node[frame->header.src].clock,
+                              pong.ping.sent, pong.received, pong.replied, arrival);
+        }
+    }
+    else if (__atomic_load_n (&port->responder, __ATOMIC_RELAXED))
+    {
+        ipc_t msg = { .cmd = SEND_PONG, .address = frame->header.src, .parameter0 = sizeof (pong) };
+        
+        pong.received = arrival;
+        pong.replied = 0;   // stamped by the sender
+        memcpy (msg.text, &pong, sizeof (pong));
+        msg.issued = arrival;
+        if (cmd_queue_push (&port->queue, &msg))
+        {
+            tx_sched_notify (&port->sched);
+            ping_echo (&port->ping, true);
+        }
+        else
+        {
+            ping_echo (&port->ping, false);
+        }
+    }
+}
+
+// @brief   Called by the White/White+ parser for every complete frame.
+// @param   arg: the port the frame came in on.
+// @param   view: the unescaped frame content and its rssi.
+
+static void
+handle_f0_f1_frame (void *arg, const frame_view_t *view)
+{
+    port_t *port = arg;
+    
+    if (dump_frames (GET_PARAMETER, false))
+    {
+        print_frames (view->data, view->len, view->rssi);
+    }
+    if (view->len > 0)
+    {
+        analyzer (&port->stats, port->address, view, handle_ping_frame, port);
+    }
+}
+
+// @brief   Run the bytes waiting in the receive ring through the parser of
+//          the current protocol.
+// @param   port: the port the bytes came in on.
+// @param   print: dump the frames to the console.
+// @param   count: number of bytes just added to the ring.
+// @param   arrival: when they were received (CLOCK_MONOTONIC, ns).
+
+static void
+handle_rx_data (port_t *port, bool print, size_t count, uint64_t arrival)
+{
+    ring_buffer_t *rx_ring = &port->rx_ring;
+    const uint8_t *p;
+    size_t len;
+    
+    // the intervals that ended before these bytes came in
+    series_tick (port->series, &port->stats, port->id, arrival);
+    
+    op_mode_t mode = __atomic_load_n (&port->mode, __ATOMIC_RELAXED);
+    if (mode == WHITE_RADIO || mode == WHITE_RADIO_PLUS)
+    {
+        // the parser keeps its own state across reads, nothing to carry over
+        for (p = ring_read_ptr (rx_ring, &len); len > 0; p = ring_read_ptr (rx_ring, &len))
+        {
+            parser_feed (&port->parser, p, len, arrival);
+            ring_consume (rx_ring, len);
+        }
+    }
+    else if (mode == ROTFUNK_PLUS)
+    {
+        handle_red_frames (port, print, arrival);
+    }
+    else if (mode == PLAIN)
+    {
+        fprintf (stdout, "read %zu bytes\n", count);
+        for (p = ring_read_ptr (rx_ring, &len); len > 0; p = ring_read_ptr (rx_ring, &len))
+        {
+            for (int i = 0; i < len; i++)
+            {
+                fprintf (stdout, "%02x ", p[i]);
+            }
+            ring_consume (rx_ring, len);
+        }
+        fprintf (stdout, "\n");
+    }
+}
+
+// @brief   Handle serial port input frames.
+// @param   port: the port to read from.
+// @param   print: dump the frames to the console.
+// @retval  0 if successful, 1 if serial port error.
+
+static int
+handle_serial_line (port_t *port, bool print)
+{
+    ring_buffer_t *rx_ring = &port->rx_ring;
+    ssize_t res;
+    size_t len;
+    uint64_t arrival = monotonic_ns ();
+    const uint8_t *chunk = ring_write_ptr (rx_ring, &len);   // where the read lands
+    capture_t *cap;
+    
+    if ((res = ring_read_fd (rx_ring, port->fd)) > 0)
+    {
+        if ((cap = __atomic_load_n (&g_capture, __ATOMIC_ACQUIRE)) != NULL)
+        {
+            capture_write (cap, CAPTURE_RX, port, chunk, res, arrival);
+        }
+#if SERIAL_DEBUG == 1
+        fprintf (stdout, "\n%llu: read %ld bytes, pending %lu\n", arrival / 1000, res, ring_used (rx_ring));
+#endif
+        handle_rx_data (port, print, res, arrival);
+        return 0;
+    }
+    else
+    {
+        perror("serial port read");
+        return 1;
+    }
+}
+
+//  @brief Feed received bytes to a port as if they came from its line; used
+//      to replay captures.
+//  @param port: the port.
+//  @param data: the bytes.
+//  @param len: their number.
+//  @param arrival: when they were received (CLOCK_MONOTONIC, ns).
+
+void
+port_feed (port_t *port, const uint8_t *data, size_t len, uint64_t arrival)
+{
+    bool print = dump_frames (GET_PARAMETER, false);
+    uint8_t *p;
+    size_t room;
+    
+    while (len > 0)
+    {
+        p = ring_write_ptr (&port->rx_ring, &room);
+        if (room == 0)
+        {
+            // only garbage fills a whole ring, the live path would drop it too
+            ring_flush (&port->rx_ring);
+            continue;
+        }
+        if (room > len)
+        {
+            room = len;
+        }
+        memcpy (p, data, room);
+        ring_commit (&port->rx_ring, room);
+        handle_rx_data (port, print, room, arrival);
+        data += room;
+        len -= room;
+    }
+}
+
+//  @brief The line went quiet: drop any truncated frame.
+
+void
+port_gap (port_t *port)
+{
+    ring_flush (&port->rx_ring);
+    parser_reset (&port->parser);
+#if SERIAL_DEBUG == 1
+    fprintf (stdout, "----\n");
+#endif
+}
+
+// @brief   Receive thread of a port.
+// @param   arg: the port.
+// @retval  a null pointer.
+
+static void *
+port_rx (void *arg)
+{
+    port_t *port = arg;
+    event_loop_t loop;
+    int gap_timer, tick_timer;
+    uint32_t us;
+    int ids[EVENT_MAX_SOURCES];
+    int res = 0;
+    
+    if (event_loop_init (&loop) < 0 ||
+        event_loop_add (&loop, port->fd, EV_SERIAL) < 0 ||
+        (gap_timer = event_timer_add (&loop, EV_RX_GAP)) < 0 ||
+        (tick_timer = event_timer_add (&loop, EV_TICK)) < 0)
+    {
+        fprintf (stdout, "Failed to set up the event loop of %s\n", port->path);
+        return NULL;
+    }
+    event_timer_arm (&loop, tick_timer, PORT_TICK_US);
+    
+    do
+    {
+        int count = event_loop_wait (&loop, ids, EVENT_MAX_SOURCES);
+        
+        for (int i = 0; i < count && res == 0; i++)
+        {
+            if (ids[i] == EV_SERIAL)
+            {
+                // got a frame from serial
+                res = handle_serial_line (port, dump_frames (GET_PARAMETER, false));
+                event_timer_arm (&loop, gap_timer, PORT_RX_GAP_US);
+            }
+            else if (ids[i] == EV_RX_GAP)
+            {
+                port_gap (port);
+            }
+            else if (ids[i] == EV_TICK)
+            {
+                // serve the statistics requests and end the series
+                // intervals, even when nothing comes in
+                stats_poll (&port->stats);
+                ping_poll (&port->ping);
+                us = series_tick (port->series, &port->stats, port->id, monotonic_ns ());
+                event_timer_arm (&loop, tick_timer, us && us < PORT_TICK_US ? us : PORT_TICK_US);
+            }
+        }
+    } while (res == 0);
+    
+    fprintf (stdout, "Port %d (%s) stopped receiving\n", port->id, port->path);
+    __atomic_store_n (&port->rx_running, false, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+//  @brief Hand a command to the sender thread of a port. Commands are never
+//      dropped silently: when the queue is full, wait for the sender to
+//      catch up, for a while. The frame settings are noted on the way,
+//      for the commands that change them for a while; the CLI thread only.
+//  @param port: the port.
+//  @param msg: the command; stamped with the time it was issued.
+
+void
+port_post (port_t *port, ipc_t *msg)
+{
+    struct timespec sts;
+    int retries = 10000;
+    
+    sts.tv_nsec = 100000;   // 100 us
+    sts.tv_sec = 0;
+    msg->issued = monotonic_ns ();
+    if (msg->cmd == LENGTH)
+    {
+        port->frame_size = msg->parameter0;
+    }
+    else if (msg->cmd == BURST)
+    {
+        port->burst = msg->parameter0;
+    }
+    else if (msg->cmd == INTERVAL)
+    {
+        port->interval = msg->parameter0;
+    }
+    while (!cmd_queue_push (&port->queue, msg))
+    {
+        if (--retries == 0)
+        {
+            fprintf (stdout, "Command queue full, command dropped\n");
+            break;
+        }
+        tx_sched_notify (&port->sched);
+        nanosleep (&sts, NULL);
+    }
+    tx_sched_notify (&port->sched);
+}
+
+//  @brief Have the statistics of a port cleared, or another table merged
+//      into them, by the thread that owns them, and wait until done; at
+//      most PORT_TICK_US while the RX thread runs.
+//  @param port: the port.
+//  @param op: STATS_CLEAR or STATS_MERGE.
+//  @param src: table to merge.
+
+void
+port_stats_request (port_t *port, stats_op_t op, const stats_table_t *src)
+{
+    struct timespec sts = { 0, 1000000 };   // 1 ms
+    
+    stats_request (&port->stats, op, src);
+    while (!stats_done (&port->stats))
+    {
+        if (!__atomic_load_n (&port->rx_running, __ATOMIC_ACQUIRE))
+        {
+            // offline, or the RX thread is gone: the statistics are ours
+            stats_poll (&port->stats);
+            break;
+        }
+        nanosleep (&sts, NULL);
+    }
+}
+
+//  @brief Clear the transmit statistics of a port; the sender thread does
+//      it, on a CLEAR_STATS command, or the caller when there is no sender.
+
+void
+port_clear_tx (port_t *port)
+{
+    seqlock_write_begin (&port->tx.lock);
+    port->tx.frames = port->tx.bytes = 0;
+    port->tx.first = port->tx.last = 0;
+    port->tx.stalls = 0;
+    seqlock_write_end (&port->tx.lock);
+    tx_sched_clear (&port->sched);
+    tx_track_clear (&port->track);
+    ping_clear_tx (&port->ping);
+}
+
+//  @brief Have all the statistics of a port cleared, each by the thread
+//      that owns them, and wait until done.
+
+void
+port_stats_clear (port_t *port)
+{
+    struct timespec sts = { 0, 1000000 };   // 1 ms
+    uint32_t clears = __atomic_load_n (&port->tx_clears, __ATOMIC_ACQUIRE);
+    ipc_t msg = { .cmd = CLEAR_STATS };
+    
+    if (__atomic_load_n (&port->tx_running, __ATOMIC_ACQUIRE))
+    {
+        port_post (port, &msg);
+    }
+    ping_clear_request (&port->ping);
+    port_stats_request (port, STATS_CLEAR, NULL);
+    
+    while (!ping_clear_done (&port->ping))
+    {
+        if (!__atomic_load_n (&port->rx_running, __ATOMIC_ACQUIRE))
+        {
+            ping_poll (&port->ping);
+            break;
+        }
+        nanosleep (&sts, NULL);
+    }
+    while (__atomic_load_n (&port->tx_clears, __ATOMIC_ACQUIRE) == clears)
+    {
+        if (!__atomic_load_n (&port->tx_running, __ATOMIC_ACQUIRE))
+        {
+            // offline, or the sender is gone
+            port_clear_tx (port);
+            break;
+        }
+        nanosleep (&sts, NULL);
+    }
+}
+
+//  @brief Consistent copy of the transmit counters of a port.
+
+void
+port_tx_snapshot (const port_t *port, tx_stats_t *tx)
+{
+    seqlock_read (&port->tx.lock, tx, &port->tx, sizeof (tx_stats_t));
+}
+
+//  @brief Start the receive and the sender threads of a port.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+port_start (port_t *port)
+{
+    port->rx_running = true;
+    port->tx_running = true;
+    if (pthread_create (&port->tx_thread, NULL, send_frames, port) ||
+        pthread_create (&port->rx_thread, NULL, port_rx, port))
+    {
+        port->rx_running = false;
+        port->tx_running = false;
+        return -1;
+    }
+    if (port->cpu >= 0)
+    {
+        port_set_affinity (port->tx_thread, port->cpu);
+        port_set_affinity (port->rx_thread, port->cpu);
+    }
+    return 0;
+}
+
+//  @brief The port the CLI commands go to.
+
+port_t *
+port_current (void)
+{
+    return g_ports[current_port];
+}
+
+//  @brief Select the port the CLI commands go to.
+//  @retval 0 if successful, -1 if there is no such port.
+
+int
+port_select (int id)
+{
+    if (id < 0 || id >= g_port_count)
+    {
+        return -1;
+    }
+    current_port = id;
+    return 0;
+}
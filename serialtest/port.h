@@ -0,0 +1,133 @@
+//
+//  port.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef port_h
+#define port_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "utils.h"
+#include "frame-parser.h"
+#include "ring-buffer.h"
+#include "cmd-queue.h"
+#include "tx-sched.h"
+#include "tx-track.h"
+#include "statistics.h"
+#include "ping.h"
+#include "stats-series.h"
+
+#define MAX_PORTS 16
+#define PORT_RX_GAP_US 2000     // a pause this long ends any frame in progress
+#define PORT_TICK_US 100000     // longest wait for the RX thread housekeeping
+
+// transmit throughput counters, kept by the sender thread behind a seqlock
+typedef struct
+{
+    uint32_t lock;
+    uint64_t frames;
+    uint64_t bytes;         // on the wire, framing and escapes included
+    uint64_t first;         // CLOCK_MONOTONIC of the first write, ns
+    uint64_t last;          // and of the last one
+    uint64_t stalls;        // waits for the driver queue to drain
+} tx_stats_t;
+
+// Everything needed to drive one serial port: the receive side (ring,
+// parser, statistics) belongs to the port's RX thread, the transmit side
+// (command queue, schedule) to its sender thread. Ports share nothing, so
+// they scale with the number of cores.
+typedef struct port_
+{
+    int id;
+    char path[256];
+    int fd;
+    int cpu;                // CPU to run the port threads on, -1 for any
+    int baudrate;
+    uint8_t address;        // own node address on this port
+    op_mode_t mode;
+    parser_ctx_t parser;
+    ring_buffer_t rx_ring;
+    stats_table_t stats;
+    cmd_queue_t queue;
+    tx_sched_t sched;
+    tx_stats_t tx;
+    tx_track_t track;
+    ping_table_t ping;
+    bool responder;         // echo the pings received; set by the CLI
+    stats_series_t *series; // per interval statistics, kept by the RX thread
+    bool rx_running;        // the RX thread owns the statistics
+    bool tx_running;        // the sender thread owns the TX statistics
+    uint32_t tx_clears;     // TX statistics clears served by the sender
+    uint32_t frame_size;    // low latency frames settings, as last
+    uint32_t burst;         // posted to the sender
+    uint32_t interval;      // us
+    pthread_t rx_thread;
+    pthread_t tx_thread;
+} port_t;
+
+extern port_t *g_ports[MAX_PORTS];
+extern int g_port_count;
+
+port_t *
+port_open (const char *path, int baudrate, uint8_t address, int cpu);
+
+port_t *
+port_offline (const char *name, uint8_t address);
+
+int
+port_start (port_t *port);
+
+void
+port_post (port_t *port, ipc_t *msg);
+
+void
+port_feed (port_t *port, const uint8_t *data, size_t len, uint64_t arrival);
+
+void
+port_gap (port_t *port);
+
+void
+port_stats_request (port_t *port, stats_op_t op, const stats_table_t *src);
+
+void
+port_clear_tx (port_t *port);
+
+void
+port_stats_clear (port_t *port);
+
+void
+port_tx_snapshot (const port_t *port, tx_stats_t *tx);
+
+port_t *
+port_current (void);
+
+int
+port_select (int id);
+
+#endif /* port_h */
@@ -0,0 +1,125 @@
+//
+//  replay.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "replay.h"
+#include "capture.h"
+#include "port.h"
+#include "tx-sched.h"
+
+
+//  @brief Run a capture through the receive path: each port of the capture
+//      gets an offline port, fed the received chunks with their original
+//      arrival times, so the parsers and the analyzer see what they saw
+//      live, line gaps included. Transmitted chunks are skipped.
+//  @param path: capture file.
+//  @param paced: keep the recorded pace instead of going as fast as possible.
+//  @retval number of received chunks replayed, or -1 on errors.
+
+int
+replay_capture (const char *path, bool paced)
+{
+    capture_reader_t reader;
+    capture_record_t rec;
+    uint64_t last_rx[MAX_PORTS] = { 0 };
+    uint64_t first = 0, start = 0;
+    uint64_t bytes = 0;
+    uint64_t began = monotonic_ns ();
+    double seconds;
+    int chunks = 0;
+    int res;
+    
+    if (capture_reader_open (&reader, path) < 0)
+    {
+        return -1;
+    }
+    
+    while ((res = capture_read (&reader, &rec)) > 0)
+    {
+        if (rec.direction != CAPTURE_RX || rec.port >= MAX_PORTS)
+        {
+            continue;
+        }
+        while (g_port_count <= rec.port)
+        {
+            char name[300];
+            snprintf (name, sizeof (name), "%s#%d", path, g_port_count);
+            if (port_offline (name, rec.address) == NULL)
+            {
+                capture_reader_close (&reader);
+                return -1;
+            }
+            // the time series go by the recording machine's clock
+            g_ports[g_port_count - 1]->series->realtime_offset = reader.realtime_offset;
+        }
+        port_t *port = g_ports[rec.port];
+        
+        if (paced)
+        {
+            if (first == 0)
+            {
+                first = rec.when;
+                start = monotonic_ns ();
+            }
+            sleep_until_ns (start + (rec.when - first));
+        }
+        // the settings in force when the chunk was received
+        port->mode = rec.mode;
+        port->address = rec.address;
+        if (last_rx[rec.port] && rec.when - last_rx[rec.port] >= PORT_RX_GAP_US * 1000ULL)
+        {
+            port_gap (port);
+        }
+        last_rx[rec.port] = rec.when;
+        
+        port_feed (port, rec.data, rec.len, rec.when);
+        bytes += rec.len;
+        chunks++;
+    }
+    capture_reader_close (&reader);
+    for (int i = 0; i < g_port_count; i++)
+    {
+        if (last_rx[i])
+        {
+            // the last interval ends with the capture
+            series_flush (g_ports[i]->series, &g_ports[i]->stats, i, last_rx[i]);
+        }
+    }
+    
+    if (res < 0)
+    {
+        fprintf (stdout, "%s: damaged record, replay stopped\n", path);
+    }
+    seconds = (monotonic_ns () - began) / 1e9;
+    fprintf (stdout, "Replayed %d chunks, %llu bytes, on %d port(s) in %.3f s (%.1f MB/s)\n",
+             chunks, (unsigned long long) bytes, g_port_count, seconds,
+             seconds > 0 ? bytes / seconds / 1e6 : 0.0);
+    return chunks;
+}
@@ -0,0 +1,236 @@
+//
+//  ring-buffer.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "ring-buffer.h"
+
+
+//  @brief Map the same shared memory object twice, back to back.
+//  @param size: size of one copy, a multiple of the page size.
+//  @retval pointer on the first copy, or NULL if the system can't do it.
+
+static uint8_t *
+ring_map_mirrored (size_t size)
+{
+    static unsigned count;
+    char name[32];
+    uint8_t *base, *p;
+    int fd;
+    
+    // short enough for macOS, where shm_open() takes 31 characters at most
+    snprintf (name, sizeof (name), "/strng-%d-%x", (int) getpid (),
+              __atomic_fetch_add (&count, 1, __ATOMIC_RELAXED));
+    fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    shm_unlink (name);  // the mappings keep it alive
+    
+    if (ftruncate (fd, size) < 0)
+    {
+        close (fd);
+        return NULL;
+    }
+    
+    // reserve the address range, then overlay both halves on the object
+    base = mmap (NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close (fd);
+        return NULL;
+    }
+    p = mmap (base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    if (p == base)
+    {
+        p = mmap (base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    }
+    close (fd);
+    
+    if (p == MAP_FAILED)
+    {
+        munmap (base, 2 * size);
+        return NULL;
+    }
+    return base;
+}
+
+//  @brief Initialize a ring buffer.
+//  @param rb: ring buffer.
+//  @param size: requested size in bytes, rounded up to a power of two (and
+//      to the page size when mirrored).
+//  @param mirrored: try to map the storage twice; if the system refuses, a
+//      plain buffer is used and rb->mirrored is false.
+//  @retval 0 if successful, -1 if out of memory.
+
+int
+ring_init (ring_buffer_t *rb, size_t size, bool mirrored)
+{
+    size_t n = 1;
+    
+    if (mirrored)
+    {
+        n = (size_t) sysconf (_SC_PAGESIZE);
+    }
+    while (n < size)
+    {
+        n <<= 1;
+    }
+    
+    rb->size = n;
+    rb->mask = n - 1;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->mirrored = false;
+    rb->data = NULL;
+    
+    if (mirrored && (rb->data = ring_map_mirrored (n)) != NULL)
+    {
+        rb->mirrored = true;
+    }
+    else if ((rb->data = malloc (n)) == NULL)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+//  @brief Release the ring buffer's storage.
+
+void
+ring_destroy (ring_buffer_t *rb)
+{
+    if (rb->mirrored)
+    {
+        munmap (rb->data, 2 * rb->size);
+    }
+    else
+    {
+        free (rb->data);
+    }
+    rb->data = NULL;
+}
+
+//  @brief Number of bytes written and not yet consumed.
+
+size_t
+ring_used (ring_buffer_t *rb)
+{
+    return __atomic_load_n (&rb->head, __ATOMIC_ACQUIRE) -
+        __atomic_load_n (&rb->tail, __ATOMIC_ACQUIRE);
+}
+
+//  @brief Producer side: where to write next.
+//  @param rb: ring buffer.
+//  @param len: returns the number of bytes that can be written contiguously.
+//  @retval write pointer.
+
+uint8_t *
+ring_write_ptr (ring_buffer_t *rb, size_t *len)
+{
+    size_t head = rb->head;
+    size_t free_space = rb->size - (head - __atomic_load_n (&rb->tail, __ATOMIC_ACQUIRE));
+    size_t offset = head & rb->mask;
+    
+    if (!rb->mirrored && free_space > rb->size - offset)
+    {
+        free_space = rb->size - offset;
+    }
+    *len = free_space;
+    return rb->data + offset;
+}
+
+//  @brief Producer side: publish len bytes written at the write pointer.
+
+void
+ring_commit (ring_buffer_t *rb, size_t len)
+{
+    __atomic_store_n (&rb->head, rb->head + len, __ATOMIC_RELEASE);
+}
+
+//  @brief Consumer side: where to read next.
+//  @param rb: ring buffer.
+//  @param len: returns the number of bytes that can be read contiguously;
+//      when mirrored this is everything available.
+//  @retval read pointer.
+
+const uint8_t *
+ring_read_ptr (ring_buffer_t *rb, size_t *len)
+{
+    size_t tail = rb->tail;
+    size_t used = __atomic_load_n (&rb->head, __ATOMIC_ACQUIRE) - tail;
+    size_t offset = tail & rb->mask;
+    
+    if (!rb->mirrored && used > rb->size - offset)
+    {
+        used = rb->size - offset;
+    }
+    *len = used;
+    return rb->data + offset;
+}
+
+//  @brief Consumer side: release len bytes.
+
+void
+ring_consume (ring_buffer_t *rb, size_t len)
+{
+    __atomic_store_n (&rb->tail, rb->tail + len, __ATOMIC_RELEASE);
+}
+
+//  @brief Consumer side: drop everything not yet consumed.
+
+void
+ring_flush (ring_buffer_t *rb)
+{
+    __atomic_store_n (&rb->tail, __atomic_load_n (&rb->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+//  @brief Read from a file descriptor straight into the ring, as much as
+//      fits contiguously.
+//  @param rb: ring buffer.
+//  @param fd: file descriptor.
+//  @retval the read() result; 0 is also returned if the ring is full.
+
+ssize_t
+ring_read_fd (ring_buffer_t *rb, int fd)
+{
+    size_t len;
+    uint8_t *p = ring_write_ptr (rb, &len);
+    ssize_t res = 0;
+    
+    if (len > 0 && (res = read (fd, p, len)) > 0)
+    {
+        ring_commit (rb, res);
+    }
+    return res;
+}
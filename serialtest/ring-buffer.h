@@ -0,0 +1,77 @@
+//
+//  ring-buffer.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef ring_buffer_h
+#define ring_buffer_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Single producer, single consumer byte ring. The positions run freely and
+// are masked on access, hence the power of two size. When mirrored, the
+// storage is mapped twice back to back, so any span up to the ring size is
+// contiguous in memory and a frame never wraps.
+typedef struct
+{
+    uint8_t *data;
+    size_t size;
+    size_t mask;
+    size_t head;        // written by the producer only
+    size_t tail;        // written by the consumer only
+    bool mirrored;
+} ring_buffer_t;
+
+int
+ring_init (ring_buffer_t *rb, size_t size, bool mirrored);
+
+void
+ring_destroy (ring_buffer_t *rb);
+
+size_t
+ring_used (ring_buffer_t *rb);
+
+uint8_t *
+ring_write_ptr (ring_buffer_t *rb, size_t *len);
+
+void
+ring_commit (ring_buffer_t *rb, size_t len);
+
+const uint8_t *
+ring_read_ptr (ring_buffer_t *rb, size_t *len);
+
+void
+ring_consume (ring_buffer_t *rb, size_t len);
+
+void
+ring_flush (ring_buffer_t *rb);
+
+ssize_t
+ring_read_fd (ring_buffer_t *rb, int fd);
+
+#endif /* ring_buffer_h */
@@ -0,0 +1,274 @@
+//
+//  saturation.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "saturation.h"
+#include "frame-parser.h"
+#include "tx-sched.h"
+
+// Counters sampled at both ends of a step.
+typedef struct
+{
+    uint64_t when;
+    uint64_t sent;
+    uint64_t wire_bytes;
+    uint64_t missed;
+    uint64_t fired;
+    uint64_t stalls;
+    uint64_t received;
+    uint64_t latency_sum;
+    uint64_t latency_samples;
+} sat_sample_t;
+
+
+static void
+sat_sample (port_t *tx, port_t *rx, sat_sample_t *s)
+{
+    static statistics_t copy;
+    static tx_sched_stats_t sched;
+    const statistics_t *node = &copy;
+    tx_stats_t counters;
+    
+    stats_node_snapshot (&rx->stats.node[tx->address], &copy);
+    port_tx_snapshot (tx, &counters);
+    tx_sched_snapshot (&tx->sched, &sched);
+    s->when = monotonic_ns ();
+    s->sent = counters.frames;
+    s->wire_bytes = counters.bytes;
+    s->missed = sched.missed;
+    s->fired = sched.fired;
+    s->stalls = counters.stalls;
+    s->received = node->frames_recvd;
+    s->latency_sum = node->latency_sum;
+    s->latency_samples = node->latency_samples;
+}
+
+static void
+sat_post (port_t *port, int cmd, uint32_t parameter)
+{
+    ipc_t msg = { .cmd = cmd, .address = BCAST_ADDRESS, .parameter0 = parameter };
+    
+    port_post (port, &msg);
+}
+
+//  @brief Send at a fixed interval for a while and measure what got through.
+//  @param baseline: mean latency of the first step, 0 while running it.
+
+static void
+sat_step (port_t *tx, port_t *rx, uint32_t interval, uint32_t step_ms, double baseline, sat_step_t *step)
+{
+    static tx_track_stats_t track;
+    struct timespec sts;
+    sat_sample_t a, b;
+    uint64_t lost;
+    
+    sat_post (tx, INTERVAL, interval);
+    // let the queues settle at the new rate before measuring
+    sts.tv_sec = step_ms / 4000;
+    sts.tv_nsec = (step_ms / 4 % 1000) * 1000000L;
+    nanosleep (&sts, NULL);
+    
+    sat_sample (tx, rx, &a);
+    sts.tv_sec = step_ms / 1000;
+    sts.tv_nsec = (step_ms % 1000) * 1000000L;
+    nanosleep (&sts, NULL);
+    sat_sample (tx, rx, &b);
+    
+    memset (step, 0, sizeof (sat_step_t));
+    step->interval = interval;
+    step->seconds = (b.when - a.when) / 1e9;
+    step->sent = b.sent - a.sent;
+    step->wire_bytes = b.wire_bytes - a.wire_bytes;
+    step->received = b.received - a.received;
+    step->missed = b.missed - a.missed;
+    step->stalls = b.stalls - a.stalls;
+    tx_track_snapshot (&tx->track, &track);
+    step->backlog = track.in_flight;
+    if (b.latency_samples > a.latency_samples)
+    {
+        step->latency = (double) (b.latency_sum - a.latency_sum) / (b.latency_samples - a.latency_samples) / 1000.0;
+    }
+    
+    // frames in flight at both ends of the step cancel out at a steady rate
+    lost = step->sent > step->received ? step->sent - step->received : 0;
+    step->saturated = step->sent == 0 ||
+                      (lost >= SAT_MIN_EVENTS && lost > step->sent * SAT_LOSS_LIMIT) ||
+                      (step->missed >= SAT_MIN_EVENTS && step->missed > (b.fired - a.fired) * SAT_LOSS_LIMIT) ||
+                      step->stalls > 0 || step->backlog > 2 ||
+                      (baseline > 0 && step->latency > baseline * SAT_LATENCY_LIMIT);
+}
+
+static void
+sat_print (const port_t *tx, int frame_len, const sat_step_t *s)
+{
+    double line_rate = tx->baudrate / 10.0;     // bytes/s, 8N1
+    double goodput = s->received * (frame_len - sizeof (frame_hdr_t)) / s->seconds;
+    double wire = s->wire_bytes / s->seconds;
+    
+    fprintf (stdout, "%9u %9.0f %9.0f %10.0f %10.0f %7.1f%% %7.1f%% %7.2f %6llu %5u%s\n",
+             s->interval, s->sent / s->seconds, s->received / s->seconds,
+             goodput, wire, goodput * 100.0 / line_rate, wire * 100.0 / line_rate, s->latency,
+             (unsigned long long) s->missed, s->backlog, s->saturated ? "  *" : "");
+}
+
+//  @brief Find the highest frame rate a link sustains: the offered load is
+//      ramped up geometrically until frames get lost, the sender falls
+//      behind, the driver queue builds up or the latency climbs; the knee
+//      is then narrowed down by bisection. Blocks for the whole run; the
+//      frame length, burst and interval of the port are put back after.
+//  @param tx: port sending the frames.
+//  @param rx: port receiving them, the same one for a loopback or an echo.
+//  @param frame_len: low latency frame length, header included.
+//  @param step_ms: measuring time per step.
+//  @retval interval at the knee in us, or -1 if the link never carried the
+//      frames.
+
+int
+saturation_run (port_t *tx, port_t *rx, int frame_len, uint32_t step_ms)
+{
+    sat_step_t steps[SAT_MAX_STEPS];
+    const sat_step_t *knee = NULL;
+    double line_rate = tx->baudrate / 10.0;
+    double baseline = 0;
+    // first guess of the frame size on the wire: CRC and framing, no escapes
+    double wire_frame = frame_len + 2 + 2 + (tx->mode > WHITE_RADIO ? 3 : 0);
+    uint32_t interval, good = 0, bad = 0;
+    int count = 0;
+    // the settings of the port, restored at the end
+    uint32_t old_size = tx->frame_size;
+    uint32_t old_burst = tx->burst;
+    uint32_t old_interval = tx->interval;
+    
+    if (line_rate <= 0)
+    {
+        return -1;
+    }
+    interval = (uint32_t) (wire_frame / (line_rate * SAT_START_LOAD) * 1e6);
+    if (interval > TX_PERIOD_MAX_US)
+    {
+        interval = TX_PERIOD_MAX_US;
+    }
+    
+    sat_post (tx, LENGTH, frame_len);
+    sat_post (tx, BURST, 1);
+    sat_post (tx, INTERVAL, interval);
+    sat_post (tx, SEND_LOW_LATENCY_FRAMES, 0);
+    
+    fprintf (stdout, "Saturating port %d at %d baud with %d bytes frames, received on port %d\n",
+             tx->id, tx->baudrate, frame_len, rx->id);
+    fprintf (stdout, "%9s %9s %9s %10s %10s %8s %8s %7s %6s %5s\n", "intv(us)", "sent/s", "recv/s",
+             "goodput", "wire B/s", "eff", "wire", "lat(ms)", "missed", "queue");
+    
+    // ramp up until the first saturated step
+    while (count < SAT_MAX_STEPS)
+    {
+        sat_step_t *s = &steps[count++];
+        
+        sat_step (tx, rx, interval, step_ms, baseline, s);
+        sat_print (tx, frame_len, s);
+        if (baseline == 0)
+        {
+            baseline = s->latency;
+        }
+        if (s->saturated)
+        {
+            bad = interval;
+            break;
+        }
+        good = interval;
+        if (s->sent)
+        {
+            // from now on, with the real frame size
+            wire_frame = (double) s->wire_bytes / s->sent;
+        }
+        if (wire_frame * 1e6 / interval > line_rate * SAT_MAX_LOAD || interval == TX_PERIOD_MIN_US)
+        {
+            break;
+        }
+        interval = (uint32_t) (interval / SAT_RAMP);
+        if (interval < TX_PERIOD_MIN_US)
+        {
+            interval = TX_PERIOD_MIN_US;
+        }
+    }
+    
+    // bisect between the last good and the first saturated interval
+    for (int i = 0; i < SAT_REFINE_STEPS && good && bad && count < SAT_MAX_STEPS && good - bad > 1; i++)
+    {
+        sat_step_t *s = &steps[count++];
+        
+        interval = (good + bad) / 2;
+        sat_step (tx, rx, interval, step_ms, baseline, s);
+        sat_print (tx, frame_len, s);
+        if (s->saturated)
+        {
+            bad = interval;
+        }
+        else
+        {
+            good = interval;
+        }
+    }
+    sat_post (tx, STOP_LOW_LATENCY_FRAMES, 0);
+    sat_post (tx, LENGTH, old_size);
+    sat_post (tx, BURST, old_burst);
+    sat_post (tx, INTERVAL, old_interval);
+    
+    for (int i = 0; i < count; i++)
+    {
+        if (!steps[i].saturated && steps[i].interval == good)
+        {
+            knee = &steps[i];
+        }
+    }
+    if (knee == NULL)
+    {
+        fprintf (stdout, "No load was carried without loss or queueing\n");
+        return -1;
+    }
+    
+    double goodput = knee->received * (frame_len - sizeof (frame_hdr_t)) / knee->seconds;
+    double wire = knee->wire_bytes / knee->seconds;
+    double frame_bytes = frame_len + 2;     // unescaped, CRC included
+    double per_frame = knee->sent ? (double) knee->wire_bytes / knee->sent : 0;
+    
+    fprintf (stdout, "%s at %u us: %.0f frames/s, goodput %.0f bytes/s (%.1f%% of %d baud), "
+             "wire %.0f bytes/s (%.1f%%)\n",
+             bad ? "Knee" : "No knee found, highest load", knee->interval,
+             knee->received / knee->seconds, goodput, goodput * 100.0 / line_rate, tx->baudrate,
+             wire, wire * 100.0 / line_rate);
+    fprintf (stdout, "Per frame: %d bytes payload, %.1f bytes on the wire (%.1f%% framing and escape "
+             "overhead over the %.0f bytes frame)\n",
+             (int) (frame_len - sizeof (frame_hdr_t)), per_frame,
+             per_frame > frame_bytes ? (per_frame / frame_bytes - 1) * 100.0 : 0.0, frame_bytes);
+    return knee->interval;
+}
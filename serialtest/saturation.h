@@ -0,0 +1,65 @@
+//
+//  saturation.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef saturation_h
+#define saturation_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "port.h"
+
+#define SAT_MAX_STEPS 40
+#define SAT_DEFAULT_STEP_MS 2000
+#define SAT_START_LOAD 0.1      // of the line rate
+#define SAT_RAMP 1.25           // offered load growth per step
+#define SAT_MAX_LOAD 2.0        // give up past twice the line rate
+#define SAT_REFINE_STEPS 3      // bisection steps once the knee is bracketed
+#define SAT_LOSS_LIMIT 0.01     // more loss than this is past the knee
+#define SAT_MIN_EVENTS 3        // but fewer lost frames or missed deadlines prove nothing
+#define SAT_LATENCY_LIMIT 4     // and so is a mean latency 4 times the first one
+
+// one load step of a saturation run
+typedef struct
+{
+    uint32_t interval;      // us between frames
+    double seconds;
+    uint64_t sent;
+    uint64_t wire_bytes;    // framing and escapes included
+    uint64_t received;
+    uint64_t missed;        // deadlines the sender could not keep
+    uint64_t stalls;        // waits for the driver queue
+    unsigned backlog;       // frames still in the driver at the end of the step
+    double latency;         // mean, ms
+    bool saturated;
+} sat_step_t;
+
+int
+saturation_run (port_t *tx, port_t *rx, int frame_len, uint32_t step_ms);
+
+#endif /* saturation_h */
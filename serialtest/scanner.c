@@ -0,0 +1,165 @@
+//
+//  scanner.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "scanner.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define SCANNER_X86 1
+#else
+#define SCANNER_X86 0
+#endif
+
+typedef const uint8_t *(*scan_func_t) (const uint8_t *p, const uint8_t *end);
+
+static const uint8_t *
+scan_resolve (const uint8_t *p, const uint8_t *end);
+
+static scan_func_t scan_engine = scan_resolve;
+
+
+//  @brief Reference byte by byte scanner.
+//  @param p: where to start the search.
+//  @param end: one past the last byte to search.
+//  @retval pointer on the first 0xf0...0xf3 byte, or end if none found.
+
+const uint8_t *
+scan_special_bytewise (const uint8_t *p, const uint8_t *end)
+{
+    while (p < end && !IS_SPECIAL (*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+//  @brief Portable scanner, tests eight bytes at a time in a 64 bit word.
+
+const uint8_t *
+scan_special_scalar (const uint8_t *p, const uint8_t *end)
+{
+#if defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    
+    while (end - p >= 8)
+    {
+        uint64_t w;
+        memcpy (&w, p, sizeof (w));
+        // special bytes become zero, then look for a zero byte
+        w = (w & (ones * SPECIAL_MASK)) ^ (ones * SPECIAL_BITS);
+        uint64_t hit = (w - ones) & ~w & highs;
+        if (hit)
+        {
+            return p + (__builtin_ctzll (hit) >> 3);
+        }
+        p += 8;
+    }
+#endif
+    return scan_special_bytewise (p, end);
+}
+
+#if SCANNER_X86
+
+__attribute__ ((target ("sse2"))) static const uint8_t *
+scan_special_sse2 (const uint8_t *p, const uint8_t *end)
+{
+    const __m128i mask = _mm_set1_epi8 ((char) SPECIAL_MASK);
+    const __m128i bits = _mm_set1_epi8 ((char) SPECIAL_BITS);
+    
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) p);
+        int hit = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_and_si128 (v, mask), bits));
+        if (hit)
+        {
+            return p + __builtin_ctz (hit);
+        }
+        p += 16;
+    }
+    return scan_special_scalar (p, end);
+}
+
+__attribute__ ((target ("avx2"))) static const uint8_t *
+scan_special_avx2 (const uint8_t *p, const uint8_t *end)
+{
+    const __m256i mask = _mm256_set1_epi8 ((char) SPECIAL_MASK);
+    const __m256i bits = _mm256_set1_epi8 ((char) SPECIAL_BITS);
+    
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256 ((const __m256i *) p);
+        unsigned hit = (unsigned) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_and_si256 (v, mask), bits));
+        if (hit)
+        {
+            return p + __builtin_ctz (hit);
+        }
+        p += 32;
+    }
+    return scan_special_sse2 (p, end);
+}
+
+#endif
+
+//  @brief First call: pick the engine, then forward the call to it. Every
+//      thread comes to the same choice, so racing here is harmless.
+
+static const uint8_t *
+scan_resolve (const uint8_t *p, const uint8_t *end)
+{
+    scan_func_t engine = scan_special_scalar;
+    
+#if SCANNER_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+    {
+        engine = scan_special_avx2;
+    }
+    else if (__builtin_cpu_supports ("sse2"))
+    {
+        engine = scan_special_sse2;
+    }
+#endif
+    __atomic_store_n (&scan_engine, engine, __ATOMIC_RELAXED);
+    return engine (p, end);
+}
+
+//  @brief Find the next special framing byte (0xf0, 0xf1, 0xf2 or 0xf3); the
+//      widest engine the CPU supports is selected on the first call.
+//  @param p: where to start the search.
+//  @param end: one past the last byte to search.
+//  @retval pointer on the first special byte, or end if none found.
+
+const uint8_t *
+scan_special (const uint8_t *p, const uint8_t *end)
+{
+    return __atomic_load_n (&scan_engine, __ATOMIC_RELAXED) (p, end);
+}
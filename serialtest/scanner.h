@@ -0,0 +1,50 @@
+//
+//  scanner.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef scanner_h
+#define scanner_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+// All the special bytes of the 0xf0/0xf1 framing (SOF, EOF, ESCAPE and SOH)
+// share the upper six bits, one mask and compare finds any of them.
+#define SPECIAL_MASK 0xfc
+#define SPECIAL_BITS 0xf0
+
+#define IS_SPECIAL(c) (((c) & SPECIAL_MASK) == SPECIAL_BITS)
+
+const uint8_t *
+scan_special (const uint8_t *p, const uint8_t *end);
+
+const uint8_t *
+scan_special_scalar (const uint8_t *p, const uint8_t *end);
+
+const uint8_t *
+scan_special_bytewise (const uint8_t *p, const uint8_t *end);
+
+#endif /* scanner_h */
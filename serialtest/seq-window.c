@@ -0,0 +1,216 @@
+//
+//  seq-window.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <string.h>
+
+#include "seq-window.h"
+
+
+//  @brief Forget all the sequence numbers seen.
+//  @param w: window.
+
+void
+seq_window_reset (seq_window_t *w)
+{
+    memset (w, 0, sizeof (seq_window_t));
+}
+
+// Clear count bits starting at pos, wrapping at the end of the window.
+// Returns how many of them were set. At most one pass over the words.
+static uint32_t
+take_bits (seq_window_t *w, uint32_t pos, uint32_t count)
+{
+    uint32_t set = 0;
+    
+    while (count)
+    {
+        uint32_t bit = pos % 64;
+        uint32_t n = 64 - bit < count ? 64 - bit : count;
+        uint64_t mask = (n == 64 ? ~0ULL : ((1ULL << n) - 1)) << bit;
+        uint64_t *word = &w->bits[pos / 64];
+        
+        set += __builtin_popcountll (*word & mask);
+        *word &= ~mask;
+        pos = (pos + n) % SEQ_WINDOW_BITS;
+        count -= n;
+    }
+    return set;
+}
+
+// Start the window over at seq, the last of the run frames received up to
+// it; the numbers still missing are forgotten, the callers count them lost.
+static void
+seq_window_restart (seq_window_t *w, uint32_t seq, uint32_t run)
+{
+    seq_window_reset (w);
+    w->top = seq;
+    w->span = run;
+    for (uint32_t i = 0; i < run; i++)
+    {
+        uint32_t n = seq - i;
+        w->bits[(n % SEQ_WINDOW_BITS) / 64] |= 1ULL << (n % 64);
+    }
+}
+
+//  @brief Account a received sequence number.
+//  @param w: window of the sender.
+//  @param seq: sequence number of the frame; differences are taken modulo
+//      2^32, so the counter may wrap.
+//  @param count: what the frame changes in the counts of the sender is
+//      added here.
+//  @retval how the frame relates to the ones before it.
+
+seq_class_t
+seq_window_update (seq_window_t *w, uint32_t seq, seq_count_t *count)
+{
+    int32_t ahead = (int32_t) (seq - w->top);
+    uint64_t mask;
+    uint32_t run;
+    seq_class_t res;
+    
+    if (w->span == 0 || (ahead < 0 && (uint32_t) -ahead >= SEQ_WINDOW_RESYNC))
+    {
+        // first frame, or the sender started over long ago
+        res = w->span == 0 ? SEQ_NEW : SEQ_RESTART;
+        count->lost += seq_window_missing (w);
+        seq_window_restart (w, seq, 1);
+        count->received++;
+        return res;
+    }
+    
+    if (ahead > 0)
+    {
+        uint32_t step = (uint32_t) ahead;
+        
+        if (step >= SEQ_WINDOW_BITS)
+        {
+            // everything goes, and the numbers jumped over never came in
+            count->lost += w->span - take_bits (w, 0, SEQ_WINDOW_BITS);
+            count->lost += step - SEQ_WINDOW_BITS;
+            w->span = SEQ_WINDOW_BITS;
+        }
+        else
+        {
+            // the slots of the new numbers are those of the oldest ones,
+            // cleared as they leave; slots outside the span are clear
+            uint32_t leaving = w->span + step > SEQ_WINDOW_BITS ? w->span + step - SEQ_WINDOW_BITS : 0;
+            
+            count->lost += leaving - take_bits (w, (w->top + 1) % SEQ_WINDOW_BITS, step);
+            w->span += step - leaving;
+        }
+        w->top = seq;
+        w->bits[(seq % SEQ_WINDOW_BITS) / 64] |= 1ULL << (seq % 64);
+        w->run_dup = w->run_late = 0;
+        count->received++;
+        return SEQ_NEW;
+    }
+    
+    mask = 1ULL << (seq % 64);
+    if ((uint32_t) -ahead >= w->span && (uint32_t) -ahead < SEQ_WINDOW_BITS &&
+        w->span < SEQ_WINDOW_BITS)
+    {
+        // older than the first frames, the window isn't full yet: it grows
+        // down to it, the numbers in between are missing from now on; the
+        // slots outside the span are clear
+        w->span = (uint32_t) -ahead + 1;
+        w->bits[(seq % SEQ_WINDOW_BITS) / 64] |= mask;
+        w->run_dup = w->run_late = 0;
+        count->received++;
+        count->late++;
+        return SEQ_REORDERED;
+    }
+    if ((uint32_t) -ahead < w->span && !(w->bits[(seq % SEQ_WINDOW_BITS) / 64] & mask))
+    {
+        w->bits[(seq % SEQ_WINDOW_BITS) / 64] |= mask;
+        w->run_dup = w->run_late = 0;
+        count->received++;
+        count->late++;
+        return SEQ_REORDERED;
+    }
+    
+    // a duplicate, or past the window
+    if (w->run_dup + w->run_late == 0 || seq != w->run_next)
+    {
+        w->run_dup = w->run_late = 0;
+    }
+    if ((uint32_t) -ahead < w->span)
+    {
+        w->run_dup++;
+        count->dup++;
+        res = SEQ_DUPLICATE;
+    }
+    else
+    {
+        w->run_late++;
+        count->late++;
+        res = SEQ_LATE;
+    }
+    w->run_next = seq + 1;
+    
+    run = w->run_dup + w->run_late;
+    if (run == SEQ_WINDOW_RESTART_RUN)
+    {
+        // the sender started over: the run was its first frames
+        count->dup -= w->run_dup;
+        count->late -= w->run_late;
+        count->received += run;
+        count->lost += seq_window_missing (w);
+        seq_window_restart (w, seq, run);
+        return SEQ_RESTART;
+    }
+    return res;
+}
+
+//  @brief Extend an 8 bit frame index to the sequence number closest to
+//      the highest one received, for the senders without the extended
+//      header; good as long as less than 128 frames in a row go missing.
+//  @param w: window of the sender.
+//  @param index: frame index.
+//  @retval sequence number.
+
+uint32_t
+seq_window_extend (const seq_window_t *w, uint8_t index)
+{
+    return w->top + (int8_t) (uint8_t) (index - (uint8_t) w->top);
+}
+
+//  @brief Count the sequence numbers in the window not received yet; they
+//      are lost unless they turn up before leaving the window.
+//  @param w: window.
+//  @retval missing sequence numbers.
+
+uint32_t
+seq_window_missing (const seq_window_t *w)
+{
+    uint32_t set = 0;
+    
+    for (int i = 0; i < SEQ_WINDOW_BITS / 64; i++)
+    {
+        set += __builtin_popcountll (w->bits[i]);
+    }
+    return w->span - set;
+}
@@ -0,0 +1,95 @@
+//
+//  seq-window.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef seq_window_h
+#define seq_window_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// depth of the window, a multiple of 64; 64 would do for the 8 bit frame
+// indexes, the 32 bit sequence numbers of the extended header can use more
+#define SEQ_WINDOW_BITS 1024
+
+// a sequence number this far behind the window means the sender restarted
+#define SEQ_WINDOW_RESYNC (SEQ_WINDOW_BITS * 4)
+
+// as does a run of this many consecutive numbers already seen, or past the
+// window; a burst of duplicates is hardly ever that long
+#define SEQ_WINDOW_RESTART_RUN 8
+
+typedef enum
+{
+    SEQ_NEW = 0,        // the highest so far, possibly after a gap
+    SEQ_REORDERED,      // behind the highest, but still expected
+    SEQ_DUPLICATE,      // already received
+    SEQ_LATE,           // too far behind, already given up as lost; it stays so
+    SEQ_RESTART,        // the sender started over, with this frame
+} seq_class_t;
+
+// what a frame changes in the counts of its sender; negative when it takes
+// back what the frames before it were counted as
+typedef struct
+{
+    int received;
+    int lost;
+    int late;
+    int dup;
+} seq_count_t;
+
+// Sliding window over the last SEQ_WINDOW_BITS sequence numbers of one
+// sender: bit (seq % SEQ_WINDOW_BITS) is set once seq was received. A
+// sequence number that leaves the window without being received is lost;
+// until then it is only missing, and may still turn up reordered. Until
+// the window is full, it also grows down to the older numbers that turn
+// up. A sender that restarts with fewer frames sent than the window is
+// deep would look like duplicates; a run of them with consecutive numbers
+// starts the window over, and is counted as received after all.
+typedef struct
+{
+    uint64_t bits[SEQ_WINDOW_BITS / 64];
+    uint32_t top;       // highest sequence number received
+    uint32_t span;      // sequence numbers in the window, up to SEQ_WINDOW_BITS
+    uint32_t run_next;  // sequence number that would go on with the run
+    uint16_t run_dup;   // run of consecutive duplicate and late frames
+    uint16_t run_late;
+} seq_window_t;
+
+void
+seq_window_reset (seq_window_t *w);
+
+seq_class_t
+seq_window_update (seq_window_t *w, uint32_t seq, seq_count_t *count);
+
+uint32_t
+seq_window_extend (const seq_window_t *w, uint8_t index);
+
+uint32_t
+seq_window_missing (const seq_window_t *w);
+
+#endif /* seq_window_h */
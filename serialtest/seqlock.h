@@ -0,0 +1,70 @@
+//
+//  seqlock.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef seqlock_h
+#define seqlock_h
+
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+
+// Single writer sequence locks, for the counters a port thread keeps and
+// the CLI reads: the writer never waits, the readers retry a copy that
+// overlapped a write. The lock is odd while a write is in progress.
+
+// Enter and leave a write section; the owning thread only.
+static inline void
+seqlock_write_begin (uint32_t *lock)
+{
+    __atomic_store_n (lock, *lock + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+static inline void
+seqlock_write_end (uint32_t *lock)
+{
+    __atomic_store_n (lock, *lock + 1, __ATOMIC_RELEASE);
+}
+
+// Copy what a lock guards, retrying while it is being written.
+static inline void
+seqlock_read (const uint32_t *lock, void *dst, const void *src, size_t len)
+{
+    uint32_t before;
+    
+    do
+    {
+        while ((before = __atomic_load_n (lock, __ATOMIC_ACQUIRE)) & 1)
+        {
+            sched_yield ();     // the writer may be off the CPU
+        }
+        memcpy (dst, src, len);
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n (lock, __ATOMIC_RELAXED) != before);
+}
+
+#endif /* seqlock_h */
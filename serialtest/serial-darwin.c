@@ -0,0 +1,357 @@
+//
+//  serial-darwin.c
+//  serialtest
+//
+//  Copyright (c) 2017 - 2021 Lix N. Paulian (lix@paulian.net)
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#if defined (__APPLE__)
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <termios.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/ioctl.h>
+#include <IOKit/serial/ioss.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOKit/IOKitLib.h>
+#include <IOKit/usb/IOUSBLib.h>
+#include <IOKit/IOBSD.h>
+#include <IOKit/IOMessage.h>
+
+#include "serial.h"
+
+
+//  @brief Open and configure the serial port (raw mode, 8N1).
+//  @param port: device path.
+//  @param baudrate: any rate the driver accepts, set through IOSSIOSPEED.
+//  @retval file descriptor, or -1 if the port could not be opened.
+
+int
+serial_open (const char *port, int baudrate)
+{
+    struct termios options;
+    int fd;
+    
+    fd = open (port, O_RDWR | O_NOCTTY | O_NDELAY);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    
+    fcntl (fd, F_SETFL, 0);
+    tcgetattr (fd, &options);
+    options.c_cflag |= (CLOCAL | CREAD);
+    options.c_oflag &= ~OPOST;
+    options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+    
+    options.c_cc[VTIME] = 0;
+    options.c_cc[VMIN] = 1;
+    options.c_cc[VERASE] = 8;
+    if (tcsetattr (fd, TCSANOW, &options) < 0)
+    {
+        fprintf (stdout, "Failed to set new parameters on the serial port\n");
+        close (fd);
+        return -1;
+    }
+    if (serial_set_baudrate (fd, baudrate) < 0)
+    {
+        fprintf (stdout, "Failed to set new baudrate\n");
+    }
+    return fd;
+}
+
+//  @brief Change the baud rate of an open serial port.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+serial_set_baudrate (int fd, int baudrate)
+{
+    speed_t speed = baudrate;
+    
+    return ioctl (fd, IOSSIOSPEED, &speed) == -1 ? -1 : 0;
+}
+
+//  @brief Number of bytes written but not yet sent by the driver.
+//  @retval byte count, or -1 on errors.
+
+int
+serial_outq (int fd)
+{
+    int queued;
+    
+    return ioctl (fd, TIOCOUTQ, &queued) < 0 ? -1 : queued;
+}
+
+//  @brief Find the callout device of a CP2102 USB to serial converter.
+//  @param location: USB location ID, hex.
+//  @param path: the device path is returned here.
+//  @param len: size of the path buffer.
+//  @retval true if found, false if not, -1 on IOKit errors.
+
+int
+serial_locate_port (char *location, char* path, size_t len)
+{
+    CFMutableDictionaryRef matchingDict;
+    io_iterator_t iter;
+    kern_return_t kr;
+    io_service_t device;
+    IOCFPlugInInterface **plugInInterface = NULL;
+    IOUSBDeviceInterface **dev = NULL;
+    SInt32 score;
+    ULONG result;
+    UInt16 vendor;
+    UInt16 product;
+    UInt16 address;
+    int res = false;
+    uint32_t find_location;
+    
+    sscanf (location, "%x", &find_location);
+    
+    /* set up a matching dictionary for the class */
+    matchingDict = IOServiceMatching(kIOUSBDeviceClassName);
+    if (matchingDict == NULL)
+    {
+        return -1; // fail
+    }
+    
+    /* Now we have a dictionary, get an iterator.*/
+    kr = IOServiceGetMatchingServices(kIOMasterPortDefault, matchingDict, &iter);
+    if (kr != KERN_SUCCESS)
+    {
+        return -1;
+    }
+    
+    /* iterate */
+    while ((device = IOIteratorNext(iter)))
+    {
+        // Create an intermediate plug-in
+        kr = IOCreatePlugInInterfaceForService(device,
+                                               kIOUSBDeviceUserClientTypeID, kIOCFPlugInInterfaceID,
+                                               &plugInInterface, &score);
+        // Don’t need the device object after intermediate plug-in is created
+        if ((kIOReturnSuccess != kr) || !plugInInterface)
+        {
+            fprintf(stdout, "Unable to create a plug-in (%08x)\n", kr);
+            continue;
+        }
+        
+        // Now create the device interface
+        result = (*plugInInterface)->QueryInterface(plugInInterface,
+                                                    // CFUUIDGetUUIDBytes(kIOUSBDeviceInterfaceID),
+                                                    // this is for macos 10.13
+                                                    CFUUIDGetUUIDBytes(kIOUSBDeviceInterfaceID650),
+                                                    (LPVOID *)&dev);
+        
+        // Don’t need the intermediate plug-in after device interface is created
+        (*plugInInterface)->Release(plugInInterface);
+        
+        if (result || !dev)
+        {
+            fprintf(stdout, "Couldn’t create a device interface (%08x)\n", (int) result);
+            continue;
+        }
+        
+        uint32_t locationID;
+        
+        kr = (*dev)->GetDeviceVendor(dev, &vendor);
+        kr = (*dev)->GetDeviceProduct(dev, &product);
+        kr = (*dev)->GetDeviceAddress (dev, &address);
+        kr = (*dev)->GetLocationID(dev, &locationID);
+        
+        if ((vendor != 0x10c4) || (product != 0xea60))
+        {
+            // we look for Silicon Labs CP2102 chips only
+            (void) (*dev)->Release(dev);
+            continue;
+        }
+        
+        if (locationID == find_location)
+        {
+            CFStringRef deviceBSDName_cf;
+            deviceBSDName_cf = (CFStringRef) IORegistryEntrySearchCFProperty (device,
+                                                                              kIOServicePlane,
+                                                                              CFSTR (kIOCalloutDeviceKey),
+                                                                              kCFAllocatorDefault,
+                                                                              kIORegistryIterateRecursively);
+            result = CFStringGetCString(deviceBSDName_cf,
+                                        path,
+                                        len,
+                                        kCFStringEncodingUTF8);
+            
+            (void) (*dev)->Release(dev);
+            IOObjectRelease(device);
+            res = true;
+            break;
+        }
+        
+        (void) (*dev)->Release(dev);
+        IOObjectRelease(device);
+    }
+    
+    /* Done, release the iterator */
+    IOObjectRelease(iter);
+    
+    return res;
+}
+
+static uint64_t
+monotonic_us (void)
+{
+    struct timespec tp;
+    
+    clock_gettime (CLOCK_MONOTONIC, &tp);
+    return (uint64_t) tp.tv_sec * 1000000 + tp.tv_nsec / 1000;
+}
+
+//  @brief Initialize an event loop; on macOS it is built on select().
+//  @retval 0 if successful, -1 otherwise.
+
+int
+event_loop_init (event_loop_t *loop)
+{
+    loop->fd_count = 0;
+    loop->timer_count = 0;
+    return 0;
+}
+
+//  @brief Watch a file descriptor for input.
+//  @param loop: event loop.
+//  @param fd: file descriptor.
+//  @param id: reported by event_loop_wait() when fd is readable.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+event_loop_add (event_loop_t *loop, int fd, int id)
+{
+    if (loop->fd_count == EVENT_MAX_SOURCES || fd >= FD_SETSIZE)
+    {
+        return -1;
+    }
+    loop->fd[loop->fd_count] = fd;
+    loop->fd_id[loop->fd_count] = id;
+    loop->fd_count++;
+    return 0;
+}
+
+//  @brief Create a one-shot timer, initially disarmed.
+//  @param loop: event loop.
+//  @param id: reported by event_loop_wait() when the timer expires.
+//  @retval timer handle for event_timer_arm(), or -1 if none left.
+
+int
+event_timer_add (event_loop_t *loop, int id)
+{
+    if (loop->timer_count == EVENT_MAX_TIMERS)
+    {
+        return -1;
+    }
+    loop->timer_id[loop->timer_count] = id;
+    loop->deadline[loop->timer_count] = 0;
+    return loop->timer_count++;
+}
+
+//  @brief (Re)arm a one-shot timer.
+//  @param loop: event loop.
+//  @param timer: handle returned by event_timer_add().
+//  @param us: expiry, in microseconds from now; 0 disarms the timer.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+event_timer_arm (event_loop_t *loop, int timer, uint32_t us)
+{
+    loop->deadline[timer] = us ? monotonic_us () + us : 0;
+    return 0;
+}
+
+//  @brief Block until at least one source is ready or a timer expires.
+//  @param loop: event loop.
+//  @param ids: the ids of the ready sources are returned here.
+//  @param max: size of the ids array.
+//  @retval number of ids returned, or -1 on error.
+
+int
+event_loop_wait (event_loop_t *loop, int *ids, int max)
+{
+    fd_set readfs;
+    struct timeval tv, *ptv = NULL;
+    uint64_t now, next = 0;
+    int maxfd = -1;
+    int count = 0;
+    
+    FD_ZERO (&readfs);
+    for (int i = 0; i < loop->fd_count; i++)
+    {
+        FD_SET (loop->fd[i], &readfs);
+        if (loop->fd[i] > maxfd)
+        {
+            maxfd = loop->fd[i];
+        }
+    }
+    for (int i = 0; i < loop->timer_count; i++)
+    {
+        if (loop->deadline[i] && (next == 0 || loop->deadline[i] < next))
+        {
+            next = loop->deadline[i];
+        }
+    }
+    if (next)
+    {
+        now = monotonic_us ();
+        next = next > now ? next - now : 0;
+        tv.tv_sec = (time_t) (next / 1000000);
+        tv.tv_usec = (suseconds_t) (next % 1000000);
+        ptv = &tv;
+    }
+    
+    if (select (maxfd + 1, &readfs, NULL, NULL, ptv) < 0)
+    {
+        return -1;
+    }
+    
+    for (int i = 0; i < loop->fd_count && count < max; i++)
+    {
+        if (FD_ISSET (loop->fd[i], &readfs))
+        {
+            ids[count++] = loop->fd_id[i];
+        }
+    }
+    now = monotonic_us ();
+    for (int i = 0; i < loop->timer_count && count < max; i++)
+    {
+        if (loop->deadline[i] && loop->deadline[i] <= now)
+        {
+            loop->deadline[i] = 0;
+            ids[count++] = loop->timer_id[i];
+        }
+    }
+    return count;
+}
+
+#endif /* __APPLE__ */
@@ -0,0 +1,281 @@
+//
+//  serial-linux.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#if defined (__linux__)
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+// termios2 and BOTHER come from the kernel headers, which clash with the
+// libc <termios.h> and <sys/ioctl.h>; declare ioctl() by hand instead
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+
+#include "serial.h"
+
+extern int
+ioctl (int fd, unsigned long request, ...);
+
+
+//  @brief Open and configure the serial port (raw mode, 8N1).
+//  @param port: device path.
+//  @param baudrate: any rate, standard or not (termios2 with BOTHER).
+//  @retval file descriptor, or -1 if the port could not be opened.
+
+int
+serial_open (const char *port, int baudrate)
+{
+    struct termios2 options;
+    int fd;
+    
+    fd = open (port, O_RDWR | O_NOCTTY | O_NDELAY);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    
+    fcntl (fd, F_SETFL, 0);
+    if (ioctl (fd, TCGETS2, &options) < 0)
+    {
+        close (fd);
+        return -1;
+    }
+    options.c_cflag |= (CLOCAL | CREAD);
+    options.c_oflag &= ~OPOST;
+    options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+    options.c_iflag &= ~(IXON | IXOFF | ICRNL | INLCR | IGNCR | ISTRIP);
+    
+    options.c_cc[VTIME] = 0;
+    options.c_cc[VMIN] = 1;
+    options.c_cc[VERASE] = 8;
+    if (ioctl (fd, TCSETS2, &options) < 0)
+    {
+        fprintf (stdout, "Failed to set new parameters on the serial port\n");
+        close (fd);
+        return -1;
+    }
+    if (serial_set_baudrate (fd, baudrate) < 0)
+    {
+        fprintf (stdout, "Failed to set new baudrate\n");
+    }
+    return fd;
+}
+
+//  @brief Change the baud rate of an open serial port; the rate is given to
+//      the driver as is, so non-standard rates work if the UART can do them.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+serial_set_baudrate (int fd, int baudrate)
+{
+    struct termios2 options;
+    
+    if (ioctl (fd, TCGETS2, &options) < 0)
+    {
+        return -1;
+    }
+    options.c_cflag &= ~CBAUD;
+    options.c_cflag |= BOTHER;
+    options.c_cflag &= ~(CBAUD << IBSHIFT);
+    options.c_cflag |= BOTHER << IBSHIFT;
+    options.c_ispeed = baudrate;
+    options.c_ospeed = baudrate;
+    return ioctl (fd, TCSETS2, &options) < 0 ? -1 : 0;
+}
+
+//  @brief Number of bytes written but not yet sent by the driver.
+//  @retval byte count, or -1 on errors.
+
+int
+serial_outq (int fd)
+{
+    int queued;
+    
+    return ioctl (fd, TIOCOUTQ, &queued) < 0 ? -1 : queued;
+}
+
+//  @brief Find a serial device by its physical location; on Linux the
+//      location is matched against the /dev/serial/by-path names (e.g.
+//      "usb-0:1.2").
+//  @param location: (part of) the by-path name.
+//  @param path: the device path is returned here.
+//  @param len: size of the path buffer.
+//  @retval true if found, false if not.
+
+int
+serial_locate_port (char *location, char* path, size_t len)
+{
+    static const char by_path[] = "/dev/serial/by-path";
+    char link[PATH_MAX];
+    char resolved[PATH_MAX];
+    struct dirent *entry;
+    int res = false;
+    DIR *dir;
+    
+    if ((dir = opendir (by_path)) == NULL)
+    {
+        return false;
+    }
+    while ((entry = readdir (dir)) != NULL)
+    {
+        if (strstr (entry->d_name, location) == NULL)
+        {
+            continue;
+        }
+        snprintf (link, sizeof (link), "%s/%s", by_path, entry->d_name);
+        if (realpath (link, resolved) != NULL && strlen (resolved) < len)
+        {
+            strcpy (path, resolved);
+            res = true;
+            break;
+        }
+    }
+    closedir (dir);
+    
+    return res;
+}
+
+//  @brief Initialize an event loop; on Linux it is built on epoll.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+event_loop_init (event_loop_t *loop)
+{
+    loop->timer_count = 0;
+    loop->epfd = epoll_create1 (EPOLL_CLOEXEC);
+    return loop->epfd < 0 ? -1 : 0;
+}
+
+//  @brief Watch a file descriptor for input.
+//  @param loop: event loop.
+//  @param fd: file descriptor.
+//  @param id: reported by event_loop_wait() when fd is readable.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+event_loop_add (event_loop_t *loop, int fd, int id)
+{
+    struct epoll_event ev;
+    
+    memset (&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t) id;
+    return epoll_ctl (loop->epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+//  @brief Create a one-shot timer (a timerfd), initially disarmed.
+//  @param loop: event loop.
+//  @param id: reported by event_loop_wait() when the timer expires.
+//  @retval timer handle for event_timer_arm(), or -1 on error.
+
+int
+event_timer_add (event_loop_t *loop, int id)
+{
+    int fd;
+    
+    if (loop->timer_count == EVENT_MAX_TIMERS)
+    {
+        return -1;
+    }
+    fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (event_loop_add (loop, fd, id) < 0)
+    {
+        close (fd);
+        return -1;
+    }
+    loop->timer_fd[loop->timer_count] = fd;
+    loop->timer_id[loop->timer_count] = id;
+    return loop->timer_count++;
+}
+
+//  @brief (Re)arm a one-shot timer.
+//  @param loop: event loop.
+//  @param timer: handle returned by event_timer_add().
+//  @param us: expiry, in microseconds from now; 0 disarms the timer.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+event_timer_arm (event_loop_t *loop, int timer, uint32_t us)
+{
+    struct itimerspec its;
+    
+    memset (&its, 0, sizeof (its));
+    its.it_value.tv_sec = us / 1000000;
+    its.it_value.tv_nsec = (us % 1000000) * 1000;
+    return timerfd_settime (loop->timer_fd[timer], 0, &its, NULL);
+}
+
+//  @brief Block until at least one source is ready or a timer expires.
+//  @param loop: event loop.
+//  @param ids: the ids of the ready sources are returned here.
+//  @param max: size of the ids array.
+//  @retval number of ids returned, or -1 on error.
+
+int
+event_loop_wait (event_loop_t *loop, int *ids, int max)
+{
+    struct epoll_event ev[EVENT_MAX_SOURCES + EVENT_MAX_TIMERS];
+    int count;
+    
+    if (max > (int) (sizeof (ev) / sizeof (ev[0])))
+    {
+        max = sizeof (ev) / sizeof (ev[0]);
+    }
+    count = epoll_wait (loop->epfd, ev, max, -1);
+    
+    for (int i = 0; i < count; i++)
+    {
+        ids[i] = (int) ev[i].data.u32;
+        for (int t = 0; t < loop->timer_count; t++)
+        {
+            if (loop->timer_id[t] == ids[i])
+            {
+                uint64_t expirations;
+                // acknowledge the expiry
+                if (read (loop->timer_fd[t], &expirations, sizeof (expirations)) < 0)
+                {
+                    ids[i] = -1;    // re-armed meanwhile, not expired
+                }
+            }
+        }
+    }
+    return count;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,84 @@
+//
+//  serial.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef serial_h
+#define serial_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Platform layer: opening and configuring the serial port, and waiting for
+// several event sources at once. The implementations live in serial-darwin.c
+// (IOKit, select) and serial-linux.c (termios2, epoll, timerfd).
+
+#define EVENT_MAX_SOURCES 8
+#define EVENT_MAX_TIMERS 4
+
+typedef struct
+{
+#if defined (__linux__)
+    int epfd;
+    int timer_fd[EVENT_MAX_TIMERS];
+#else
+    int fd[EVENT_MAX_SOURCES];
+    int fd_id[EVENT_MAX_SOURCES];
+    int fd_count;
+    uint64_t deadline[EVENT_MAX_TIMERS];    // 0 if not armed
+#endif
+    int timer_id[EVENT_MAX_TIMERS];
+    int timer_count;
+} event_loop_t;
+
+int
+serial_open (const char *port, int baudrate);
+
+int
+serial_set_baudrate (int fd, int baudrate);
+
+int
+serial_outq (int fd);
+
+int
+serial_locate_port (char *location, char *path, size_t len);
+
+int
+event_loop_init (event_loop_t *loop);
+
+int
+event_loop_add (event_loop_t *loop, int fd, int id);
+
+int
+event_timer_add (event_loop_t *loop, int id);
+
+int
+event_timer_arm (event_loop_t *loop, int timer, uint32_t us);
+
+int
+event_loop_wait (event_loop_t *loop, int *ids, int max);
+
+#endif /* serial_h */
@@ -0,0 +1,428 @@
+//
+//  serialbench.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+// Micro-benchmarks of the receive and transmit hot path, run over synthetic
+// traffic; built as a separate tool, so results can be collected by
+// scripts and compared between builds:
+//
+//  serialbench [-t <ms>] [-o <file.csv>]
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "frame-parser.h"
+#include "statistics.h"
+
+#define CORPUS_WIRE_SIZE (1024 * 1024)  // encoded bytes per corpus
+#define CORPUS_MAX_FRAMES (CORPUS_WIRE_SIZE / 16)
+#define CORPUS_PADDING 16               // the legacy parser peeks past the end
+#define WHITE_RSSI 0x37                 // appended by White radios after EOF
+#define BENCH_DEFAULT_MS 250            // minimum run time per measurement
+
+typedef enum
+{
+    PAYLOAD_CLEAN,      // no byte needs escaping
+    PAYLOAD_ESCAPES,    // about half of the bytes need escaping
+} payload_t;
+
+// A synthetic traffic sample: the frames as built by the sender (CRC
+// included) and the same frames as they come out of the radio.
+typedef struct
+{
+    const char *name;
+    op_mode_t mode;
+    int frames;
+    uint8_t *raw;           // unencoded frames, back to back
+    size_t raw_len;
+    size_t *raw_off;
+    size_t *raw_size;
+    uint8_t *wire;          // received byte stream
+    size_t wire_len;
+    size_t *wire_off;       // SOF of each frame
+    size_t *wire_size;      // up to the EOF, or the rssi byte for White
+} corpus_t;
+
+typedef struct
+{
+    const char *name;
+    size_t (*func) (const corpus_t *c);
+    bool on_wire;       // works on the received stream, not the raw frames
+    bool framed;        // needs frames, meaningless on noise
+} bench_t;
+
+static stats_table_t stats;
+static uint8_t scratch[MAX_FRAME_LEN * 2];
+
+
+//-----------------------------------------------------------------------------
+// Corpora.
+
+// Build one (sub-)frame with a valid header and CRC.
+static size_t
+make_frame (uint8_t *dst, int len, payload_t payload, uint8_t index)
+{
+    frame_t *frame = (frame_t *) dst;
+    uint16_t crc;
+    
+    frame->header.len = len;
+    frame->header.dest = BCAST_ADDRESS;
+    frame->header.src = 1;
+    frame->header.index = index;
+    frame->header.type = LOW_LATENCY;
+    frame->header.timestamp = 0;
+    for (int i = sizeof (frame_hdr_t); i < len; i++)
+    {
+        if (payload == PAYLOAD_ESCAPES && (rand () & 1))
+        {
+            dst[i] = SOF_CHAR + rand () % 4;
+        }
+        else
+        {
+            dst[i] = (uint8_t) (rand () % SOF_CHAR);
+        }
+    }
+    crc = calcCRC (0, dst, len);
+    dst[len] = (uint8_t) crc;
+    dst[len + 1] = (uint8_t) (crc >> 8);
+    return len + 2;
+}
+
+//  @brief Fill a corpus with frames until the encoded stream is full.
+//  @param c: corpus, name and mode set.
+//  @param payload: payload kind.
+//  @param min_len, max_len: (sub-)frame length range, header included.
+//  @param subframes: number of sub-frames carried by each radio frame.
+
+static void
+make_corpus (corpus_t *c, payload_t payload, int min_len, int max_len, int subframes)
+{
+    uint8_t index = 0;
+    
+    c->raw = malloc (CORPUS_WIRE_SIZE);
+    c->wire = calloc (1, CORPUS_WIRE_SIZE + CORPUS_PADDING);
+    c->raw_off = malloc (CORPUS_MAX_FRAMES * sizeof (size_t));
+    c->raw_size = malloc (CORPUS_MAX_FRAMES * sizeof (size_t));
+    c->wire_off = malloc (CORPUS_MAX_FRAMES * sizeof (size_t));
+    c->wire_size = malloc (CORPUS_MAX_FRAMES * sizeof (size_t));
+    c->frames = 0;
+    c->raw_len = c->wire_len = 0;
+    if (!c->raw || !c->wire || !c->raw_off || !c->raw_size || !c->wire_off || !c->wire_size)
+    {
+        fprintf (stdout, "Out of memory\n");
+        exit (EXIT_FAILURE);
+    }
+    
+    srand (1);
+    while (c->frames < CORPUS_MAX_FRAMES)
+    {
+        uint8_t encoded[MAX_FRAME_LEN];
+        size_t size = 0;
+        size_t len;
+        
+        for (int s = 0; s < subframes; s++)
+        {
+            int flen = min_len + rand () % (max_len - min_len + 1);
+            size += make_frame (c->raw + c->raw_len + size, flen, payload, index++);
+        }
+        len = encode_frame (encoded, c->raw + c->raw_len, (int) size, c->mode, 0);
+        if (c->mode == WHITE_RADIO_PLUS)
+        {
+            encoded[2] = WHITE_RSSI;   // the radio puts the rssi in the header
+        }
+        else
+        {
+            encoded[len++] = WHITE_RSSI;
+        }
+        if (c->wire_len + len > CORPUS_WIRE_SIZE)
+        {
+            break;
+        }
+        
+        c->raw_off[c->frames] = c->raw_len;
+        c->raw_size[c->frames] = size;
+        c->raw_len += size;
+        
+        memcpy (c->wire + c->wire_len, encoded, len);
+        c->wire_off[c->frames] = c->wire_len + (c->mode == WHITE_RADIO_PLUS ? 3 : 0);
+        c->wire_size[c->frames] = len - (c->mode == WHITE_RADIO_PLUS ? 3 : 0);
+        c->wire_len += len;
+        c->frames++;
+    }
+}
+
+// Random bytes, no framing at all.
+static void
+make_noise (corpus_t *c)
+{
+    c->raw = c->wire = calloc (1, CORPUS_WIRE_SIZE + CORPUS_PADDING);
+    if (c->wire == NULL)
+    {
+        fprintf (stdout, "Out of memory\n");
+        exit (EXIT_FAILURE);
+    }
+    srand (1);
+    for (int i = 0; i < CORPUS_WIRE_SIZE; i++)
+    {
+        c->wire[i] = (uint8_t) rand ();
+    }
+    c->raw_len = c->wire_len = CORPUS_WIRE_SIZE;
+    c->frames = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmarks; each one goes once over a corpus and returns something
+// derived from the results, so the work can't be optimized away.
+
+static size_t
+bench_calc_crc (const corpus_t *c)
+{
+    size_t sink = 0;
+    
+    if (c->frames == 0)
+    {
+        return calcCRC (0, c->raw, (int) c->raw_len);
+    }
+    for (int i = 0; i < c->frames; i++)
+    {
+        sink += calcCRC (0, c->raw + c->raw_off[i], (int) c->raw_size[i] - 2);
+    }
+    return sink;
+}
+
+static size_t
+bench_encode_frame (const corpus_t *c)
+{
+    size_t sink = 0;
+    
+    for (int i = 0; i < c->frames; i++)
+    {
+        sink += encode_frame (scratch, c->raw + c->raw_off[i], (int) c->raw_size[i], c->mode, 0);
+    }
+    return sink;
+}
+
+// The legacy two step receive path: find the frame boundaries...
+static size_t
+bench_parse_f0_f1_frames (const corpus_t *c)
+{
+    uint8_t *p = c->wire;
+    uint8_t *end = c->wire + c->wire_len;
+    size_t sink = 0;
+    
+    while (p < end)
+    {
+        uint8_t *begin = p;
+        uint8_t *stop = end;
+        int8_t rssi;
+        parse_result_t res = parse_f0_f1_frames (&begin, &stop, &rssi);
+        
+        if (res == FRAME_NOT_FOUND || stop >= end)
+        {
+            break;
+        }
+        sink += (res == FRAME_OK) + (stop - begin);
+        p = stop + 1;
+    }
+    return sink;
+}
+
+// ...then copy each frame out and unescape it.
+static size_t
+bench_extract_f0_f1_frame (const corpus_t *c)
+{
+    size_t sink = 0;
+    
+    for (int i = 0; i < c->frames; i++)
+    {
+        memcpy (scratch, c->wire + c->wire_off[i], c->wire_size[i]);
+        sink += extract_f0_f1_frame (scratch, c->wire_size[i]);
+    }
+    return sink;
+}
+
+static void
+count_frame (void *arg, const frame_view_t *view)
+{
+    *(size_t *) arg += view->len;
+}
+
+// The streaming parser of the live receive path, fed 4 KB reads.
+static size_t
+bench_parser_feed (const corpus_t *c)
+{
+    parser_ctx_t ctx;
+    size_t sink = 0;
+    
+    parser_init (&ctx, count_frame, &sink);
+    for (size_t off = 0; off < c->wire_len; off += 4096)
+    {
+        size_t len = c->wire_len - off < 4096 ? c->wire_len - off : 4096;
+        parser_feed (&ctx, c->wire + off, len, 0);
+    }
+    return sink;
+}
+
+static size_t
+bench_analyzer (const corpus_t *c)
+{
+    frame_view_t view;
+    
+    view.rssi = -WHITE_RSSI;
+    view.arrival = 1000000;
+    for (int i = 0; i < c->frames; i++)
+    {
+        view.data = c->raw + c->raw_off[i];
+        view.len = c->raw_size[i];
+        analyzer (&stats, 0, &view, NULL, NULL);
+    }
+    return stats.total_recvd_frames;
+}
+
+static const bench_t benches[] =
+{
+    { "calcCRC", bench_calc_crc, false, false },
+    { "encode_frame", bench_encode_frame, false, true },
+    { "parse_f0_f1_frames", bench_parse_f0_f1_frames, true, false },
+    { "extract_f0_f1_frame", bench_extract_f0_f1_frame, true, true },
+    { "parser_feed", bench_parser_feed, true, false },
+    { "analyzer", bench_analyzer, false, true },
+    { NULL, NULL, false, false }
+};
+
+//-----------------------------------------------------------------------------
+
+//  @brief Run a benchmark over a corpus for at least min_ns.
+//  @param ns_byte: the time per byte is returned here.
+//  @param frames_s: the frame rate is returned here.
+
+static void
+run_bench (const bench_t *b, const corpus_t *c, uint64_t min_ns, double *ns_byte, double *frames_s)
+{
+    volatile size_t sink = 0;
+    uint64_t start, elapsed;
+    long rounds = 0;
+    size_t bytes = b->on_wire ? c->wire_len : c->raw_len;
+    
+    sink += b->func (c);    // warm up the caches
+    start = monotonic_ns ();
+    do
+    {
+        sink += b->func (c);
+        rounds++;
+        elapsed = monotonic_ns () - start;
+    } while (elapsed < min_ns);
+    
+    *ns_byte = (double) elapsed / ((double) rounds * bytes);
+    *frames_s = (double) rounds * c->frames * 1e9 / elapsed;
+    (void) sink;
+}
+
+int
+main (int argc, char * argv[])
+{
+    static corpus_t corpora[] =
+    {
+        { .name = "clean", .mode = WHITE_RADIO },
+        { .name = "escapes", .mode = WHITE_RADIO },
+        { .name = "noise", .mode = WHITE_RADIO },
+        { .name = "white+", .mode = WHITE_RADIO_PLUS },
+        { .name = "subframes", .mode = WHITE_RADIO },
+    };
+    uint64_t min_ns = BENCH_DEFAULT_MS * 1000000ULL;
+    FILE *out = NULL;
+    int ch;
+    
+    while ((ch = getopt (argc, argv, "ht:o:")) != -1)
+    {
+        switch (ch)
+        {
+            case 't':
+                min_ns = strtoull (optarg, NULL, 0) * 1000000ULL;
+                break;
+                
+            case 'o':
+                if ((out = fopen (optarg, "w")) == NULL)
+                {
+                    perror (optarg);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+                
+            case 'h':
+            default:
+                fprintf (stdout, "Usage: serialbench [-t <ms per measurement>] [-o <results.csv>]\n");
+                exit (EXIT_SUCCESS);
+                break;
+        }
+    }
+    
+    make_corpus (&corpora[0], PAYLOAD_CLEAN, 16, 120, 1);
+    make_corpus (&corpora[1], PAYLOAD_ESCAPES, 16, 100, 1);
+    make_noise (&corpora[2]);
+    make_corpus (&corpora[3], PAYLOAD_CLEAN, 16, 120, 1);
+    make_corpus (&corpora[4], PAYLOAD_CLEAN, 12, 16, 6);
+    
+    fprintf (stdout, "%-22s%-12s%12s%14s%10s\n", "benchmark", "corpus", "ns/byte", "frames/s", "MB/s");
+    if (out)
+    {
+        fprintf (out, "benchmark,corpus,mode,frames,bytes,ns_per_byte,frames_per_s\n");
+    }
+    for (int b = 0; benches[b].name; b++)
+    {
+        for (int i = 0; i < (int) (sizeof (corpora) / sizeof (corpora[0])); i++)
+        {
+            const corpus_t *c = &corpora[i];
+            double ns_byte, frames_s;
+            
+            if (benches[b].framed && c->frames == 0)
+            {
+                continue;
+            }
+            clear_stats (&stats);
+            run_bench (&benches[b], c, min_ns, &ns_byte, &frames_s);
+            
+            fprintf (stdout, "%-22s%-12s%12.3f%14.0f%10.1f\n", benches[b].name, c->name,
+                     ns_byte, frames_s, 1e3 / ns_byte);
+            if (out)
+            {
+                fprintf (out, "%s,%s,%d,%d,%zu,%.4f,%.0f\n", benches[b].name, c->name, c->mode,
+                         c->frames, benches[b].on_wire ? c->wire_len : c->raw_len, ns_byte, frames_s);
+            }
+        }
+    }
+    if (out)
+    {
+        fclose (out);
+    }
+    
+    return EXIT_SUCCESS;
+}
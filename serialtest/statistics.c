@@ -32,130 +32,402 @@
 #include <sys/time.h>
 
 #include "statistics.h"
+#include "seqlock.h"
 #include "frame-parser.h"
 #include "utils.h"
 
 
-statistics_t g_stats[255];
-uint32_t g_crc_error_count;
-uint32_t g_total_recvd_frames;
+//  @brief Compute the latency of a received frame.
+//  @param frame: the received frame.
+//  @param arrival: when it was received (CLOCK_MONOTONIC, ns).
+//  @param clock: estimate of the sender's clock; when there is one, the
+//      timestamp is first brought to our clock.
+//  @retval latency in us; exact with the extended header, modulo 1 s with
+//      the legacy 32 bit timestamp.
+
+static uint32_t
+frame_latency (const frame_t *frame, uint64_t arrival, const clock_est_t *clock)
+{
+    const frame_ext_t *ext = (const frame_ext_t *) frame->payload;
+    uint32_t latency;
+    int64_t offset;
+    
+    if (clock_est_offset (clock, arrival, &offset))
+    {
+        // the same as moving the sender's timestamp back by the offset
+        arrival += offset;
+    }
+    
+    if ((frame->header.type & FRAME_TYPE_EXT) &&
+        frame->header.len >= sizeof (frame_hdr_t) + offsetof (frame_ext_t, seq) &&
+        FRAME_EXT_HAS (ext, timestamp))
+    {
+        uint64_t timestamp = ext->timestamp;
+        return arrival > timestamp ? (uint32_t) ((arrival - timestamp) / 1000) : 0;
+    }
+    
+    latency = (uint32_t) ((arrival % 1000000000) / 1000);
+    if (latency > frame->header.timestamp)
+    {
+        latency -= frame->header.timestamp;
+    }
+    else
+    {
+        latency = latency + 1000000 - frame->header.timestamp;
+    }
+    return latency;
+}
+
+//  @brief Check and account the sub-frames of a received frame.
+//  @param table: statistics of the port the frame came in on.
+//  @param address: own address of that port.
+//  @param view: the received frame; the CRC is checked straight on it.
+//  @param hook: called for the ping and pong frames, may be NULL.
+//  @param arg: passed to the hook.
 
 void
-analyzer (uint8_t *data, size_t len, int8_t rssi)
+analyzer (stats_table_t *table, uint8_t address, const frame_view_t *view, frame_hook_t hook, void *arg)
 {
-    frame_t *frame;
-    struct timespec tp;
-    int lost_frames;
-    size_t count_left = len;
+    const frame_t *frame;
+    const uint8_t *data = view->data;
+    int8_t rssi = view->rssi;
+    size_t count_left = view->len;
     
+    stats_poll (table);
+    seqlock_write_begin (&table->lock);
     do
     {
-        frame = (frame_t *) data;
-        if (frame->header.len < 6)  // simple sanity check
+        frame = (const frame_t *) data;
+        if (count_left < sizeof (frame_hdr_t) + 2 ||
+            frame->header.len < 6 ||  // simple sanity check
+            frame->header.len + 2 > count_left)
         {
             break;
         }
         uint16_t crc = data[frame->header.len];
         crc |=  (data[frame->header.len + 1] << 8);
-        if (calcCRC (0, data, (int) frame->header.len) == crc)
+        if (calcCRC (0, (uint8_t *) data, (int) frame->header.len) == crc)
         {
             if (frame->header.dest == BCAST_ADDRESS ||
-                frame->header.dest == own_address (GET_PARAMETER, 0))
+                frame->header.dest == address)
             {
-                clock_gettime (CLOCK_MONOTONIC, &tp);
-                uint32_t latency = (uint32_t) (tp.tv_nsec / 1000);
+                statistics_t *ps = &table->node[frame->header.src];
+                const frame_ext_t *ext = (const frame_ext_t *) frame->payload;
+                uint32_t latency = frame_latency (frame, view->arrival, &ps->clock);
+                seq_count_t count = { 0 };
+                uint32_t seq;
                 
-                g_stats[frame->header.src].frames_recvd++;
-                
-                if (latency > frame->header.timestamp)
+                seqlock_write_begin (&ps->lock);
+
+                // identify lost, reordered and duplicate frames; the senders
+                // without sequence numbers give only the 8 bit index
+                if ((frame->header.type & FRAME_TYPE_EXT) &&
+                    frame->header.len >= sizeof (frame_hdr_t) + sizeof (frame_ext_t) &&
+                    FRAME_EXT_HAS (ext, seq))
                 {
-                    latency -= frame->header.timestamp;
+                    seq = ext->seq;
                 }
                 else
                 {
-                    latency = latency + 1000000 - frame->header.timestamp;
+                    seq = seq_window_extend (&ps->seq, frame->header.index);
                 }
+                // frames past the window were counted as lost when their
+                // number left it, they stay lost and are not received
+                seq_window_update (&ps->seq, seq, &count);
+                ps->frames_recvd += count.received;
+                ps->frames_lost += count.lost;
+                ps->frames_late += count.late;
+                ps->frames_dup += count.dup;
                 
                 // store latency values
-                g_stats[frame->header.src].latency_sum += latency;
-                g_stats[frame->header.src].latency_samples++;
+                ps->latency_sum += latency;
+                ps->latency_samples++;
                 
-                if (latency > g_stats[frame->header.src].latency_max)
+                if (latency > ps->latency_max)
                 {
-                    g_stats[frame->header.src].latency_max = latency;
+                    ps->latency_max = latency;
                 }
-                if (latency < g_stats[frame->header.src].latency_min)
-                {
-                    g_stats[frame->header.src].latency_min = latency;
-                }
-                
-                // identify lost frames
-                if (g_stats[frame->header.src].frames_recvd != 0)
+                if (latency < ps->latency_min)
                 {
-                    if (g_stats[frame->header.src].last_index < frame->header.index)
-                    {
-                        lost_frames = frame->header.index - g_stats[frame->header.src].last_index - 1;
-                    }
-                    else
-                    {
-                        lost_frames = 255 + frame->header.index - g_stats[frame->header.src].last_index;
-                    }
-                    g_stats[frame->header.src].frames_lost += lost_frames;
+                    ps->latency_min = latency;
                 }
-                g_stats[frame->header.src].last_index = frame->header.index;
+                hist_record (&ps->latency_hist, latency);
                 
                 // store rssi value
-                if ( g_stats[frame->header.src].rssi_samples > 10)
+                ps->rssi_total += rssi;
+                ps->rssi_frames++;
+                if (ps->rssi_samples > 10)
                 {
-                    g_stats[frame->header.src].rssi_sum = rssi;
-                    g_stats[frame->header.src].rssi_samples = 1;
+                    ps->rssi_sum = rssi;
+                    ps->rssi_samples = 1;
                 }
                 else
                 {
-                    g_stats[frame->header.src].rssi_sum += rssi;
-                    g_stats[frame->header.src].rssi_samples++;
+                    ps->rssi_sum += rssi;
+                    ps->rssi_samples++;
                 }
                 
                 // handle specific frames
-                switch (frame->header.type)
+                switch (frame->header.type & FRAME_TYPE_MASK)
                 {
                     case LOW_LATENCY:
                         break;
                         
                     case FILE_XFER:
                         break;
+                        
+                    case PING:
+                    case PONG:
+                        if (hook)
+                        {
+                            hook (arg, frame, view->arrival);
+                        }
+                        break;
                 }
+                seqlock_write_end (&ps->lock);
             }
         }
         else
         {
-            g_crc_error_count++;
+            table->crc_error_count++;
         }
-        g_total_recvd_frames++;
+        table->total_recvd_frames++;
         
         data += (frame->header.len + 2);
         count_left -= (frame->header.len + 2);
     } while (count_left);
+    seqlock_write_end (&table->lock);
 }
 
-//  @brief  Clear the statistic data
+//  @brief  Clear the statistic data; from the thread that owns the table,
+//      the others go through stats_request().
 void
-clear_stats (void)
+clear_stats (stats_table_t *table)
 {
     statistics_t *ps;
     int i;
     
-    for (i = 0, ps = g_stats; i < 255; i++, ps++)
+    for (i = 0, ps = table->node; i < STATS_NODES; i++, ps++)
     {
+        seqlock_write_begin (&ps->lock);
+        seq_window_reset (&ps->seq);
         ps->frames_lost = 0;
+        ps->frames_late = 0;
+        ps->frames_dup = 0;
         ps->frames_recvd = 0;
         ps->latency_max = 0;
         ps->latency_min = 100000;   // initial value 100 ms
         ps->latency_samples = 0;
         ps->latency_sum = 0;
+        hist_reset (&ps->latency_hist);
         ps->rssi_samples = 0;
         ps->rssi_sum = 0;
+        ps->rssi_total = 0;
+        ps->rssi_frames = 0;
+        seqlock_write_end (&ps->lock);
+    }
+    seqlock_write_begin (&table->lock);
+    table->crc_error_count = 0;
+    table->total_recvd_frames = 0;
+    table->clears++;
+    seqlock_write_end (&table->lock);
+}
+
+//  @brief Frames of a node lost so far: those given up, and those still
+//      missing from the window, which may yet come in reordered.
+//  @param ps: statistics of the node.
+//  @retval lost frames.
+
+int
+frames_lost (const statistics_t *ps)
+{
+    return ps->frames_lost + (int) seq_window_missing (&ps->seq);
+}
+
+//  @brief Add the statistics of one port to another table, node by node.
+//  @param dst: destination table; written as by clear_stats().
+//  @param src: source table, left unchanged; a snapshot if it is live.
+
+void
+merge_stats (stats_table_t *dst, const stats_table_t *src)
+{
+    for (int i = 0; i < STATS_NODES; i++)
+    {
+        statistics_t *pd = &dst->node[i];
+        const statistics_t *ps = &src->node[i];
+        
+        if (ps->frames_recvd == 0 && ps->latency_hist.total == 0)
+        {
+            continue;
+        }
+        seqlock_write_begin (&pd->lock);
+        pd->frames_recvd += ps->frames_recvd;
+        pd->frames_lost += frames_lost (ps);
+        pd->frames_late += ps->frames_late;
+        pd->frames_dup += ps->frames_dup;
+        if (ps->latency_max > pd->latency_max)
+        {
+            pd->latency_max = ps->latency_max;
+        }
+        if (ps->latency_min < pd->latency_min)
+        {
+            pd->latency_min = ps->latency_min;
+        }
+        pd->latency_sum += ps->latency_sum;
+        pd->latency_samples += ps->latency_samples;
+        hist_merge (&pd->latency_hist, &ps->latency_hist);
+        pd->rssi_sum += ps->rssi_sum;
+        pd->rssi_samples += ps->rssi_samples;
+        pd->rssi_total += ps->rssi_total;
+        pd->rssi_frames += ps->rssi_frames;
+        seqlock_write_end (&pd->lock);
+    }
+    seqlock_write_begin (&dst->lock);
+    dst->crc_error_count += src->crc_error_count;
+    dst->total_recvd_frames += src->total_recvd_frames;
+    seqlock_write_end (&dst->lock);
+}
+
+//  @brief Take a consistent copy of a table, node by node, without holding
+//      up its RX thread.
+//  @param table: statistics of a port.
+//  @param copy: the copy is returned here.
+
+void
+stats_snapshot (const stats_table_t *table, stats_table_t *copy)
+{
+    for (int i = 0; i < STATS_NODES; i++)
+    {
+        stats_node_snapshot (&table->node[i], &copy->node[i]);
+    }
+    seqlock_read (&table->lock, &copy->lock, &table->lock,
+                  offsetof (stats_table_t, request) - offsetof (stats_table_t, lock));
+    copy->request = STATS_IDLE;
+    copy->merge = NULL;
+}
+
+//  @brief Take a consistent copy of the statistics of one node.
+//  @param ps: statistics of the node, in a live table.
+//  @param copy: the copy is returned here.
+
+void
+stats_node_snapshot (const statistics_t *ps, statistics_t *copy)
+{
+    seqlock_read (&ps->lock, copy, ps, sizeof (statistics_t));
+}
+
+//  @brief Ask the thread that owns a table to clear it, or to merge another
+//      table into it; see stats_done() for when it did.
+//  @param table: statistics of a port.
+//  @param op: STATS_CLEAR or STATS_MERGE.
+//  @param src: table to merge, left alone until done.
+
+void
+stats_request (stats_table_t *table, stats_op_t op, const stats_table_t *src)
+{
+    table->merge = src;
+    __atomic_store_n (&table->request, op, __ATOMIC_RELEASE);
+}
+
+//  @brief Check whether the last request on a table was carried out.
+
+bool
+stats_done (const stats_table_t *table)
+{
+    return __atomic_load_n (&table->request, __ATOMIC_ACQUIRE) == STATS_IDLE;
+}
+
+//  @brief Carry out the pending request on a table; called by the thread
+//      that owns it, for every frame and every now and then.
+
+void
+stats_poll (stats_table_t *table)
+{
+    int op = __atomic_load_n (&table->request, __ATOMIC_ACQUIRE);
+    
+    if (op == STATS_IDLE)
+    {
+        return;
+    }
+    if (op == STATS_CLEAR)
+    {
+        clear_stats (table);
+    }
+    else if (op == STATS_MERGE && table->merge)
+    {
+        merge_stats (table, table->merge);
+    }
+    __atomic_store_n (&table->request, STATS_IDLE, __ATOMIC_RELEASE);
+}
+
+//  @brief Merge the latency histograms of all nodes.
+//  @param table: statistics of a port.
+//  @param all: the merged histogram is returned here.
+
+void
+latency_summary (const stats_table_t *table, histogram_t *all)
+{
+    hist_reset (all);
+    for (int i = 0; i < STATS_NODES; i++)
+    {
+        hist_merge (all, &table->node[i].latency_hist);
+    }
+}
+
+//  @brief Save the latency histograms of all nodes heard from.
+//  @param table: statistics of a port.
+//  @param path: output file.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+save_latency (const stats_table_t *table, const char *path)
+{
+    FILE *fp;
+    int res = 0;
+    
+    if ((fp = fopen (path, "w")) == NULL)
+    {
+        return -1;
+    }
+    for (int i = 0; i < STATS_NODES && res == 0; i++)
+    {
+        if (table->node[i].latency_hist.total)
+        {
+            res = hist_write (fp, i, &table->node[i].latency_hist);
+        }
+    }
+    if (fclose (fp))
+    {
+        res = -1;
+    }
+    return res;
+}
+
+//  @brief Merge latency histograms saved by a previous run into the
+//      current ones, node by node.
+//  @param table: statistics of a port.
+//  @param path: input file.
+//  @retval number of histograms merged, or -1 on errors.
+
+int
+load_latency (stats_table_t *table, const char *path)
+{
+    static histogram_t h;
+    FILE *fp;
+    int id, res, count = 0;
+    
+    if ((fp = fopen (path, "r")) == NULL)
+    {
+        return -1;
+    }
+    while ((res = hist_read (fp, &id, &h)) > 0)
+    {
+        if (id >= 0 && id < STATS_NODES)
+        {
+            hist_merge (&table->node[id].latency_hist, &h);
+            count++;
+        }
     }
-    g_crc_error_count = 0;
-    g_total_recvd_frames = 0;
+    fclose (fp);
+    return res < 0 ? -1 : count;
 }
@@ -30,27 +30,96 @@
 
 #include <stdio.h>
 
+#include "frame-parser.h"
+#include "histogram.h"
+#include "clock-sync.h"
+#include "seq-window.h"
+
+#define STATS_NODES 256     // one per source address, broadcast included
+
+// Each node, and the counters of the table, are guarded by a seqlock: the
+// sequence is odd while the only writer, the RX thread of the port,
+// updates them. The other threads read through stats_snapshot(), which
+// copies and retries until it sees the same even sequence before and after,
+// so the receive path never waits for them; their changes (clear, merge)
+// are handed to the RX thread with stats_request().
 typedef struct statistics_
 {
-    uint8_t last_index;
-    int frames_recvd;
-    int frames_lost;
+    uint32_t lock;              // seqlock
+    seq_window_t seq;
+    int frames_recvd;           // duplicates and frames past the window excluded
+    int frames_lost;            // left the window without coming in
+    int frames_late;            // reordered, or past the window and counted as lost
+    int frames_dup;
     uint32_t latency_max;
     uint32_t latency_min;
     uint64_t latency_sum;
     uint32_t latency_samples;
+    histogram_t latency_hist;   // us
     int rssi_sum;
     int rssi_samples;
+    int64_t rssi_total;         // since cleared, for the time series
+    uint32_t rssi_frames;
+    clock_est_t clock;          // the node's clock against ours, kept by clear_stats()
 } statistics_t;
 
-extern statistics_t g_stats[];
-extern uint32_t g_crc_error_count;
-extern uint32_t g_total_recvd_frames;
+typedef enum
+{
+    STATS_IDLE = 0,
+    STATS_CLEAR,
+    STATS_MERGE,
+} stats_op_t;
+
+// all the statistics of one port, indexed by the source node address
+typedef struct stats_table_
+{
+    statistics_t node[STATS_NODES];
+    uint32_t lock;              // seqlock of the counters below
+    uint32_t crc_error_count;
+    uint32_t total_recvd_frames;
+    uint32_t clears;            // bumped by clear_stats()
+    int request;                // stats_op_t, STATS_IDLE once carried out
+    const struct stats_table_ *merge;
+} stats_table_t;
+
+// called by the analyzer for the good frames it does not handle itself
+// (pings and pongs); the frame is only valid during the call
+typedef void (*frame_hook_t) (void *arg, const frame_t *frame, uint64_t arrival);
+
+void
+analyzer (stats_table_t *table, uint8_t address, const frame_view_t *view, frame_hook_t hook, void *arg);
+
+void
+clear_stats (stats_table_t *table);
+
+void
+stats_snapshot (const stats_table_t *table, stats_table_t *copy);
+
+void
+stats_node_snapshot (const statistics_t *ps, statistics_t *copy);
 
 void
-analyzer (uint8_t *frame, size_t len, int8_t rssi);
+stats_request (stats_table_t *table, stats_op_t op, const stats_table_t *src);
+
+bool
+stats_done (const stats_table_t *table);
 
 void
-clear_stats (void);
+stats_poll (stats_table_t *table);
+
+int
+frames_lost (const statistics_t *ps);
+
+void
+merge_stats (stats_table_t *dst, const stats_table_t *src);
+
+void
+latency_summary (const stats_table_t *table, histogram_t *all);
+
+int
+save_latency (const stats_table_t *table, const char *path);
+
+int
+load_latency (stats_table_t *table, const char *path);
 
 #endif /* statistics_h */
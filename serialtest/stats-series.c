@@ -0,0 +1,328 @@
+//
+//  stats-series.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats-series.h"
+
+
+//  @brief Allocate a series, stopped. All its memory comes with it.
+//  @retval the series, or NULL if out of memory.
+
+stats_series_t *
+series_alloc (void)
+{
+    return calloc (1, sizeof (stats_series_t));
+}
+
+//  @brief Start a series, or restart it with another interval; the samples
+//      already taken are kept. May be called from any thread.
+//  @param s: series.
+//  @param interval_ms: interval length, 0 for SERIES_INTERVAL_MS.
+
+void
+series_start (stats_series_t *s, uint32_t interval_ms)
+{
+    struct timespec rt, mt;
+    
+    clock_gettime (CLOCK_REALTIME, &rt);
+    clock_gettime (CLOCK_MONOTONIC, &mt);
+    s->realtime_offset = ((int64_t) rt.tv_sec - mt.tv_sec) * 1000000000 + (rt.tv_nsec - mt.tv_nsec);
+    __atomic_store_n (&s->interval_ms, interval_ms ? interval_ms : SERIES_INTERVAL_MS, __ATOMIC_RELAXED);
+    __atomic_store_n (&s->restart, true, __ATOMIC_RELEASE);
+    __atomic_store_n (&s->enabled, true, __ATOMIC_RELEASE);
+}
+
+//  @brief Stop taking samples; those taken are kept.
+
+void
+series_stop (stats_series_t *s)
+{
+    __atomic_store_n (&s->enabled, false, __ATOMIC_RELEASE);
+}
+
+// Keep the counters of a node, for the difference at the end of the next
+// interval; all zero without ps.
+static void
+series_keep (series_node_t *pn, const statistics_t *ps)
+{
+    if (ps)
+    {
+        pn->frames = ps->frames_recvd;
+        pn->lost = frames_lost (ps);
+        pn->late = ps->frames_late;
+        pn->dup = ps->frames_dup;
+        pn->rssi_total = ps->rssi_total;
+        pn->rssi_frames = ps->rssi_frames;
+        pn->latency = ps->latency_hist;
+    }
+    else
+    {
+        pn->frames = pn->lost = pn->late = pn->dup = 0;
+        pn->rssi_total = 0;
+        pn->rssi_frames = 0;
+        hist_reset (&pn->latency);
+    }
+}
+
+// Start following a node, from the given counters on.
+static void
+series_follow (stats_series_t *s, int node, const statistics_t *ps)
+{
+    if (s->node_count == SERIES_NODES)
+    {
+        s->slot[node] = 0;
+        s->untracked++;
+        return;
+    }
+    s->nodes[s->node_count].node = node;
+    series_keep (&s->nodes[s->node_count], ps);
+    s->slot[node] = ++s->node_count;
+}
+
+// Take the baseline of all the nodes heard from so far.
+static void
+series_restart (stats_series_t *s, const stats_table_t *table, uint64_t now)
+{
+    s->interval = __atomic_load_n (&s->interval_ms, __ATOMIC_RELAXED) * 1000000ULL;
+    s->start = now;
+    s->next = now + s->interval;
+    s->node_count = 0;
+    s->clears = table->clears;
+    s->untracked = 0;
+    memset (s->slot, 0xff, sizeof (s->slot));
+    for (int i = 0; i < STATS_NODES; i++)
+    {
+        const statistics_t *ps = &table->node[i];
+        
+        if (ps->frames_recvd || ps->frames_dup)
+        {
+            series_follow (s, i, ps);
+        }
+    }
+}
+
+// Write the sample of one node for the interval just ended, and keep its
+// counters for the next one.
+static void
+series_sample (stats_series_t *s, series_node_t *pn, const statistics_t *ps, int port, bool cleared)
+{
+    series_sample_t *sample = &s->ring[s->head % SERIES_DEPTH];
+    histogram_t *h = &s->scratch;
+    uint32_t rssi_frames;
+    
+    if (cleared)
+    {
+        // the counters start over from zero
+        series_keep (pn, NULL);
+    }
+    
+    sample->start = s->start + s->realtime_offset;
+    sample->length = (uint32_t) ((s->next - s->start) / 1000);
+    sample->port = port;
+    sample->node = pn->node;
+    sample->reserved = 0;
+    sample->frames = ps->frames_recvd - pn->frames;
+    sample->lost = frames_lost (ps) - pn->lost;
+    sample->late = ps->frames_late - pn->late;
+    sample->dup = ps->frames_dup - pn->dup;
+    rssi_frames = ps->rssi_frames - pn->rssi_frames;
+    sample->rssi = rssi_frames ? (int8_t) ((ps->rssi_total - pn->rssi_total) / rssi_frames) : 0;
+    
+    // the latencies of the interval are the difference of the histograms
+    h->total = ps->latency_hist.total - pn->latency.total;
+    h->min = ps->latency_hist.min;
+    h->max = ps->latency_hist.max;
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        h->counts[i] = ps->latency_hist.counts[i] - pn->latency.counts[i];
+    }
+    sample->latency[0] = hist_percentile (h, 50);
+    sample->latency[1] = hist_percentile (h, 90);
+    sample->latency[2] = hist_percentile (h, 99);
+    sample->latency[3] = hist_percentile (h, 100);
+    
+    series_keep (pn, ps);
+    
+    // publish the sample
+    __atomic_store_n (&s->head, s->head + 1, __ATOMIC_RELEASE);
+}
+
+// Write the samples of all the nodes followed for the interval from start
+// to next, after taking in the nodes heard from for the first time.
+static void
+series_close (stats_series_t *s, const stats_table_t *table, int port)
+{
+    bool cleared = table->clears != s->clears;
+    
+    s->clears = table->clears;
+    for (int i = 0; i < STATS_NODES; i++)
+    {
+        const statistics_t *ps = &table->node[i];
+        
+        if (s->slot[i] == 0xff && (ps->frames_recvd || ps->frames_dup))
+        {
+            series_follow (s, i, NULL);
+        }
+    }
+    for (int i = 0; i < s->node_count; i++)
+    {
+        series_sample (s, &s->nodes[i], &table->node[s->nodes[i].node], port, cleared);
+    }
+}
+
+//  @brief Close the intervals that ended by now; called by the RX thread of
+//      the port, for each read and on a timer, so that the intervals
+//      without any frame end on time as well.
+//  @param s: series of the port.
+//  @param table: statistics of the port.
+//  @param port: port id, stored in the samples.
+//  @param now: CLOCK_MONOTONIC, or the arrival time of a replayed chunk, ns.
+//  @retval microseconds until the current interval ends, or 0 if stopped.
+
+uint32_t
+series_tick (stats_series_t *s, const stats_table_t *table, int port, uint64_t now)
+{
+    if (s == NULL || !__atomic_load_n (&s->enabled, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+    if (__atomic_exchange_n (&s->restart, false, __ATOMIC_ACQ_REL))
+    {
+        series_restart (s, table, now);
+    }
+    
+    if (now >= s->next)
+    {
+        do
+        {
+            series_close (s, table, port);
+            s->start = s->next;
+            s->next += s->interval;
+            if (now - s->start > s->interval * SERIES_DEPTH)
+            {
+                // a long silence in a replay, no sample would be left anyway
+                s->start = now - (now - s->start) % s->interval;
+                s->next = s->start + s->interval;
+            }
+        } while (now >= s->next);
+    }
+    return (uint32_t) ((s->next - now) / 1000) + 1;
+}
+
+//  @brief End the current interval early, at the end of a replay; its
+//      samples are shorter than the others. Called by the thread that
+//      feeds the port.
+//  @param s: series of the port.
+//  @param table: statistics of the port.
+//  @param port: port id, stored in the samples.
+//  @param now: end of the interval, as for series_tick().
+
+void
+series_flush (stats_series_t *s, const stats_table_t *table, int port, uint64_t now)
+{
+    if (series_tick (s, table, port, now) && now > s->start)
+    {
+        s->next = now;
+        series_close (s, table, port);
+        s->start = now;
+        s->next = now + s->interval;
+    }
+}
+
+// One sample as a CSV line.
+static int
+series_print (FILE *fp, const series_sample_t *sample)
+{
+    return fprintf (fp, "%d,%llu.%06llu,%.3f,%d,%u,%d,%u,%u,%.3f,%.3f,%.3f,%.3f,%d\n",
+                    sample->port,
+                    (unsigned long long) (sample->start / 1000000000),
+                    (unsigned long long) (sample->start % 1000000000 / 1000),
+                    sample->length / 1e6, sample->node,
+                    sample->frames, sample->lost, sample->late, sample->dup,
+                    sample->latency[0] / 1000.0, sample->latency[1] / 1000.0,
+                    sample->latency[2] / 1000.0, sample->latency[3] / 1000.0,
+                    sample->rssi) < 0 ? -1 : 0;
+}
+
+//  @brief Start a series file: the CSV column names, or the binary header.
+//  @param fp: output file.
+//  @param format: CSV or binary.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+series_save_header (FILE *fp, series_format_t format)
+{
+    if (format == SERIES_BINARY)
+    {
+        uint16_t version = SERIES_VERSION;
+        uint16_t size = sizeof (series_sample_t);
+        
+        return (fwrite (SERIES_MAGIC, 4, 1, fp) == 1 &&
+                fwrite (&version, sizeof (version), 1, fp) == 1 &&
+                fwrite (&size, sizeof (size), 1, fp) == 1) ? 0 : -1;
+    }
+    return fprintf (fp, "port,time,length_s,node,frames,lost,late,duplicates,"
+                    "latency_p50_ms,latency_p90_ms,latency_p99_ms,latency_max_ms,rssi_dbm\n") < 0 ? -1 : 0;
+}
+
+//  @brief Append the samples of a series to a file, oldest first. Does not
+//      stop the series; the samples overwritten while being copied are
+//      left out.
+//  @param s: series.
+//  @param fp: output file, started with series_save_header().
+//  @param format: CSV or binary.
+//  @retval number of samples saved, or -1 on errors.
+
+int
+series_save (const stats_series_t *s, FILE *fp, series_format_t format)
+{
+    uint64_t head = __atomic_load_n (&s->head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > SERIES_DEPTH ? head - SERIES_DEPTH : 0;
+    series_sample_t sample;
+    int count = 0;
+    
+    for (uint64_t i = first; i < head; i++)
+    {
+        memcpy (&sample, &s->ring[i % SERIES_DEPTH], sizeof (sample));
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+        if (__atomic_load_n (&s->head, __ATOMIC_RELAXED) - i >= SERIES_DEPTH)
+        {
+            // the RX thread got round to the slot meanwhile
+            continue;
+        }
+        if (format == SERIES_BINARY ? fwrite (&sample, sizeof (sample), 1, fp) != 1 :
+            series_print (fp, &sample) < 0)
+        {
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,130 @@
+//
+//  stats-series.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef stats_series_h
+#define stats_series_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "histogram.h"
+#include "statistics.h"
+
+#define SERIES_DEPTH 65536          // samples kept, the oldest are overwritten
+#define SERIES_NODES 16             // nodes followed per port
+#define SERIES_INTERVAL_MS 1000     // default interval
+
+#define SERIES_MAGIC "STSR"         // binary files: magic, version, sample size,
+#define SERIES_VERSION 1            // then the samples, in host byte order
+
+typedef enum
+{
+    SERIES_CSV = 0,
+    SERIES_BINARY,
+} series_format_t;
+
+// what one node did during one interval
+typedef struct __attribute__ ((packed))
+{
+    uint64_t start;         // CLOCK_REALTIME at the interval start, ns
+    uint32_t length;        // interval, us
+    uint8_t port;
+    uint8_t node;
+    int8_t rssi;            // mean over the interval, dBm; 0 without frames
+    uint8_t reserved;
+    uint32_t frames;
+    int32_t lost;           // negative when frames missing turned up late
+    uint32_t late;
+    uint32_t dup;
+    uint32_t latency[4];    // 50th, 90th, 99th percentile and max, us
+} series_sample_t;
+
+// the counters of a node at the end of the last interval
+typedef struct
+{
+    uint8_t node;
+    int frames;
+    int lost;
+    int late;
+    int dup;
+    int64_t rssi_total;
+    uint32_t rssi_frames;
+    histogram_t latency;
+} series_node_t;
+
+// Time series of the statistics of one port: at the end of every interval,
+// the RX thread takes the difference between the statistics table and the
+// counters kept at the end of the previous one, for each node followed,
+// and writes it in a ring of SERIES_DEPTH samples. Nothing is allocated
+// once the series exists, and a node stays followed through silent
+// intervals, so outages show as empty samples. Readers never block the
+// RX thread: a sample is written before head moves past it, and a copy is
+// kept only if head shows it was not overwritten meanwhile.
+typedef struct
+{
+    series_sample_t ring[SERIES_DEPTH];
+    uint64_t head;          // samples written so far
+    bool enabled;
+    bool restart;           // set by series_start(), taken by the RX thread
+    uint32_t interval_ms;
+    int64_t realtime_offset;    // CLOCK_REALTIME - CLOCK_MONOTONIC, ns
+    
+    // owned by the RX thread
+    uint64_t interval;      // ns
+    uint64_t start;         // CLOCK_MONOTONIC of the current interval, ns
+    uint64_t next;          // and of the next one
+    uint8_t slot[STATS_NODES];  // 1 + index in nodes, 0 if no room, 0xff if not heard
+    series_node_t nodes[SERIES_NODES];
+    int node_count;
+    uint32_t clears;        // of the table, when the counters were kept
+    uint32_t untracked;     // nodes heard from with all the slots taken
+    histogram_t scratch;
+} stats_series_t;
+
+stats_series_t *
+series_alloc (void);
+
+void
+series_start (stats_series_t *s, uint32_t interval_ms);
+
+void
+series_stop (stats_series_t *s);
+
+uint32_t
+series_tick (stats_series_t *s, const stats_table_t *table, int port, uint64_t now);
+
+void
+series_flush (stats_series_t *s, const stats_table_t *table, int port, uint64_t now);
+
+int
+series_save_header (FILE *fp, series_format_t format);
+
+int
+series_save (const stats_series_t *s, FILE *fp, series_format_t format);
+
+#endif /* stats_series_h */
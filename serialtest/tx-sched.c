@@ -0,0 +1,272 @@
+//
+//  tx-sched.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#if defined (__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#else
+#include <sys/select.h>
+#endif
+
+#include "tx-sched.h"
+#include "seqlock.h"
+#include "utils.h"
+
+
+//  @brief Sleep until an absolute CLOCK_MONOTONIC time.
+//  @param deadline: wake-up time, ns.
+
+void
+sleep_until_ns (uint64_t deadline)
+{
+#if defined (__linux__)
+    struct timespec ts;
+    
+    ts.tv_sec = (time_t) (deadline / 1000000000);
+    ts.tv_nsec = (long) (deadline % 1000000000);
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+        ;
+    }
+#else
+    // no clock_nanosleep on macOS; the deadline stays absolute, only the
+    // residual error of one relative sleep is added
+    uint64_t now = monotonic_ns ();
+    struct timespec ts;
+    
+    if (deadline > now)
+    {
+        ts.tv_sec = (time_t) ((deadline - now) / 1000000000);
+        ts.tv_nsec = (long) ((deadline - now) % 1000000000);
+        nanosleep (&ts, NULL);
+    }
+#endif
+}
+
+//  @brief Initialize a transmit schedule, with its wake-up descriptors.
+//  @param s: schedule.
+//  @param period_us: period, microseconds.
+//  @retval 0 if successful, -1 otherwise.
+
+int
+tx_sched_init (tx_sched_t *s, uint32_t period_us)
+{
+    s->period = (uint64_t) period_us * 1000;
+    s->next = 0;
+    s->stats.lock = 0;
+    tx_sched_clear (s);
+#if defined (__linux__)
+    s->wake_rd = s->wake_wr = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    s->timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (s->wake_rd < 0 || s->timer_fd < 0)
+    {
+        return -1;
+    }
+#else
+    int fd[2];
+    
+    s->timer_fd = -1;
+    if (pipe (fd) < 0)
+    {
+        return -1;
+    }
+    fcntl (fd[0], F_SETFL, O_NONBLOCK);
+    fcntl (fd[1], F_SETFL, O_NONBLOCK);
+    s->wake_rd = fd[0];
+    s->wake_wr = fd[1];
+#endif
+    return 0;
+}
+
+//  @brief (Re)start the schedule; the first deadline is now.
+
+void
+tx_sched_start (tx_sched_t *s)
+{
+    s->next = monotonic_ns ();
+}
+
+//  @brief Change the period and restart the schedule.
+
+void
+tx_sched_set_period (tx_sched_t *s, uint32_t period_us)
+{
+    s->period = (uint64_t) period_us * 1000;
+    tx_sched_start (s);
+}
+
+//  @brief Wake up the sender; callable from any thread.
+
+void
+tx_sched_notify (tx_sched_t *s)
+{
+    uint64_t one = 1;
+    
+    // a full pipe or a saturated counter means a wake-up is already pending
+    (void) write (s->wake_wr, &one, s->wake_rd == s->wake_wr ? sizeof (one) : 1);
+}
+
+// Block until a wake-up time (0 for none) or a notification, whichever first.
+static void
+tx_sched_block (tx_sched_t *s, uint64_t wake)
+{
+    uint8_t drain[64];
+#if defined (__linux__)
+    struct pollfd fds[2];
+    
+    if (wake)
+    {
+        struct itimerspec its;
+        
+        memset (&its, 0, sizeof (its));
+        its.it_value.tv_sec = (time_t) (wake / 1000000000);
+        its.it_value.tv_nsec = (long) (wake % 1000000000);
+        timerfd_settime (s->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    }
+    fds[0].fd = s->wake_rd;
+    fds[0].events = POLLIN;
+    fds[1].fd = s->timer_fd;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;     // not polled without a wake-up time
+    poll (fds, wake ? 2 : 1, -1);
+    if (fds[1].revents & POLLIN)
+    {
+        (void) read (s->timer_fd, drain, sizeof (uint64_t));
+    }
+#else
+    // no absolute timers with select(); only the residual error of one
+    // relative wait is added, the deadline itself stays absolute
+    struct timeval tv, *ptv = NULL;
+    fd_set readfs;
+    
+    if (wake)
+    {
+        uint64_t now = monotonic_ns ();
+        uint64_t left = wake > now ? wake - now : 0;
+        tv.tv_sec = (time_t) (left / 1000000000);
+        tv.tv_usec = (suseconds_t) ((left % 1000000000) / 1000);
+        ptv = &tv;
+    }
+    FD_ZERO (&readfs);
+    FD_SET (s->wake_rd, &readfs);
+    select (s->wake_rd + 1, &readfs, NULL, NULL, ptv);
+#endif
+    while (read (s->wake_rd, drain, sizeof (drain)) > 0)
+    {
+        ;
+    }
+}
+
+//  @brief Wait for the next deadline, for a notification, or for an extra
+//      wake-up time, whichever comes first.
+//  @param s: schedule.
+//  @param armed: false to ignore the deadline (nothing to send).
+//  @param wake_at: extra wake-up time (CLOCK_MONOTONIC, ns), 0 for none.
+//  @retval true if the deadline was reached, the schedule is then advanced;
+//      false if woken up before it.
+
+bool
+tx_sched_wait (tx_sched_t *s, bool armed, uint64_t wake_at)
+{
+    uint64_t now = monotonic_ns ();
+    uint64_t late;
+    
+    if (!armed || now < s->next)
+    {
+        uint64_t wake = armed ? s->next : 0;
+        if (wake_at && (wake == 0 || wake_at < wake))
+        {
+            wake = wake_at;
+        }
+        if (wake == 0 || wake > now)
+        {
+            tx_sched_block (s, wake);
+        }
+        now = monotonic_ns ();
+        if (!armed || now < s->next)
+        {
+            return false;
+        }
+    }
+    late = now - s->next;
+    seqlock_write_begin (&s->stats.lock);
+    if (late >= s->period)
+    {
+        // skip the deadlines already gone, keep the phase
+        uint64_t skipped = late / s->period;
+        s->stats.missed += skipped;
+        s->next += skipped * s->period;
+        late -= skipped * s->period;
+    }
+    hist_record (&s->stats.jitter, late > UINT32_MAX ? UINT32_MAX : (uint32_t) late);
+    s->stats.fired++;
+    seqlock_write_end (&s->stats.lock);
+    s->next += s->period;
+    return true;
+}
+
+//  @brief Record the time from the issue of a command to its end.
+//  @param s: schedule.
+//  @param latency: ns.
+
+void
+tx_sched_command (tx_sched_t *s, uint64_t latency)
+{
+    seqlock_write_begin (&s->stats.lock);
+    hist_record (&s->stats.cmd_latency, latency > UINT32_MAX ? UINT32_MAX : (uint32_t) latency);
+    seqlock_write_end (&s->stats.lock);
+}
+
+//  @brief Clear the schedule statistics; the sender thread only, once
+//      started.
+
+void
+tx_sched_clear (tx_sched_t *s)
+{
+    seqlock_write_begin (&s->stats.lock);
+    s->stats.fired = 0;
+    s->stats.missed = 0;
+    hist_reset (&s->stats.jitter);
+    hist_reset (&s->stats.cmd_latency);
+    seqlock_write_end (&s->stats.lock);
+}
+
+//  @brief Consistent copy of the schedule statistics, from any thread.
+
+void
+tx_sched_snapshot (const tx_sched_t *s, tx_sched_stats_t *stats)
+{
+    seqlock_read (&s->stats.lock, stats, &s->stats, sizeof (tx_sched_stats_t));
+}
@@ -0,0 +1,95 @@
+//
+//  tx-sched.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef tx_sched_h
+#define tx_sched_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "histogram.h"
+
+#define TX_PERIOD_MIN_US 10
+#define TX_PERIOD_MAX_US 1000000
+#define TX_PERIOD_DEFAULT_US 20000
+
+// schedule statistics, kept by the sender thread behind a seqlock
+typedef struct
+{
+    uint32_t lock;
+    uint64_t fired;         // deadlines served
+    uint64_t missed;        // deadlines skipped
+    histogram_t jitter;     // wake-up lateness, ns
+    histogram_t cmd_latency;    // command issue to wire, ns
+} tx_sched_stats_t;
+
+// Periodic transmit schedule. Deadlines are absolute (CLOCK_MONOTONIC), the
+// next one is always the previous one plus the period, so the time spent
+// sending never accumulates into drift. When the sender falls behind by one
+// or more whole periods, those deadlines are counted as missed and skipped
+// rather than sent in a burst.
+// The sender blocks on the deadline and on a wake-up descriptor at the same
+// time, so a queued command is served at once and an idle sender sleeps.
+typedef struct
+{
+    uint64_t period;        // ns
+    uint64_t next;          // next deadline, ns
+    tx_sched_stats_t stats;
+    int wake_rd;            // eventfd on Linux, a pipe elsewhere
+    int wake_wr;
+    int timer_fd;           // Linux only, -1 elsewhere
+} tx_sched_t;
+
+int
+tx_sched_init (tx_sched_t *s, uint32_t period_us);
+
+void
+tx_sched_start (tx_sched_t *s);
+
+void
+tx_sched_set_period (tx_sched_t *s, uint32_t period_us);
+
+bool
+tx_sched_wait (tx_sched_t *s, bool armed, uint64_t wake_at);
+
+void
+tx_sched_notify (tx_sched_t *s);
+
+void
+tx_sched_command (tx_sched_t *s, uint64_t latency);
+
+void
+tx_sched_clear (tx_sched_t *s);
+
+void
+tx_sched_snapshot (const tx_sched_t *s, tx_sched_stats_t *stats);
+
+void
+sleep_until_ns (uint64_t deadline);
+
+#endif /* tx_sched_h */
@@ -0,0 +1,186 @@
+//
+//  tx-track.c
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "tx-track.h"
+#include "tx-sched.h"
+#include "seqlock.h"
+#include "serial.h"
+#include "utils.h"
+
+
+// Time a number of bytes needs on the wire, 8N1.
+static uint64_t
+byte_time (int baudrate, uint64_t bytes)
+{
+    return baudrate > 0 ? bytes * 10 * 1000000000 / baudrate : 0;
+}
+
+//  @brief Initialize a tracker, nothing in flight.
+
+void
+tx_track_init (tx_track_t *t)
+{
+    memset (t, 0, sizeof (tx_track_t));
+    hist_reset (&t->stats.serialization);
+}
+
+//  @brief Number of frames written but not seen leaving yet; the sender
+//      thread only, the others take a snapshot.
+
+unsigned
+tx_track_in_flight (const tx_track_t *t)
+{
+    return t->head - t->tail;
+}
+
+//  @brief Record a frame just written to the serial port.
+//  @param t: tracker.
+//  @param fd: serial port, to make room when too many frames are in flight.
+//  @param baudrate: current baud rate.
+//  @param len: bytes written.
+//  @param when: when they were written, ns.
+
+void
+tx_track_write (tx_track_t *t, int fd, int baudrate, size_t len, uint64_t when)
+{
+    tx_record_t *record;
+    
+    while (tx_track_in_flight (t) == TX_TRACK_DEPTH)
+    {
+        sleep_until_ns (tx_track_poll (t, fd, baudrate));
+    }
+    if (tx_track_in_flight (t) == 0)
+    {
+        t->poll_at = when + byte_time (baudrate, len);
+    }
+    t->written += len;
+    record = &t->record[t->head & (TX_TRACK_DEPTH - 1)];
+    record->end = t->written;
+    record->written = when;
+    seqlock_write_begin (&t->stats.lock);
+    t->head++;
+    t->stats.in_flight = tx_track_in_flight (t);
+    seqlock_write_end (&t->stats.lock);
+}
+
+//  @brief Retire the frames that left the driver and timestamp them.
+//  @param t: tracker.
+//  @param fd: serial port.
+//  @param baudrate: current baud rate.
+//  @retval when to poll again, ns; 0 if nothing is in flight.
+
+uint64_t
+tx_track_poll (tx_track_t *t, int fd, int baudrate)
+{
+    uint64_t now, sent;
+    int queued;
+    
+    if (tx_track_in_flight (t) == 0)
+    {
+        return t->poll_at = 0;
+    }
+    queued = serial_outq (fd);
+    now = monotonic_ns ();
+    sent = t->written - (queued > 0 ? queued : 0);
+    
+    seqlock_write_begin (&t->stats.lock);
+    while (t->tail != t->head)
+    {
+        tx_record_t *record = &t->record[t->tail & (TX_TRACK_DEPTH - 1)];
+        uint64_t len, start, done;
+        
+        if (record->end > sent)
+        {
+            break;
+        }
+        // the frame started when written, or when the line got free, and
+        // can't be through before its bytes had time to go out: the driver
+        // hands them to the UART (or USB bridge) FIFO ahead of the line;
+        // when it says more time was needed, the last frame it let go
+        // gets it
+        len = record->end - t->retired;
+        start = record->written > t->line_free ? record->written : t->line_free;
+        done = start + byte_time (baudrate, len);
+        if (done < now && (t->tail + 1 == t->head ||
+                           t->record[(t->tail + 1) & (TX_TRACK_DEPTH - 1)].end > sent))
+        {
+            done = now;
+        }
+        hist_record (&t->stats.serialization, done - start > UINT32_MAX ? UINT32_MAX : (uint32_t) (done - start));
+        t->line_free = done;
+        t->retired = record->end;
+        t->stats.completed++;
+        t->tail++;
+    }
+    t->stats.in_flight = tx_track_in_flight (t);
+    seqlock_write_end (&t->stats.lock);
+    
+    if (t->tail == t->head)
+    {
+        return t->poll_at = 0;
+    }
+    // look again when the oldest frame should be through
+    t->poll_at = now + byte_time (baudrate, t->record[t->tail & (TX_TRACK_DEPTH - 1)].end - sent) + 1000;
+    return t->poll_at;
+}
+
+//  @brief Clear the statistics; the frames in flight stay tracked. The
+//      sender thread only, once started.
+
+void
+tx_track_clear (tx_track_t *t)
+{
+    seqlock_write_begin (&t->stats.lock);
+    t->stats.completed = 0;
+    hist_reset (&t->stats.serialization);
+    seqlock_write_end (&t->stats.lock);
+}
+
+//  @brief Consistent copy of the statistics, from any thread.
+
+void
+tx_track_snapshot (const tx_track_t *t, tx_track_stats_t *stats)
+{
+    seqlock_read (&t->stats.lock, stats, &t->stats, sizeof (tx_track_stats_t));
+}
+
+//  @brief Wait until every frame written has left the driver.
+
+void
+tx_track_drain (tx_track_t *t, int fd, int baudrate)
+{
+    uint64_t poll_at;
+    
+    while ((poll_at = tx_track_poll (t, fd, baudrate)) != 0)
+    {
+        sleep_until_ns (poll_at);
+    }
+}
@@ -0,0 +1,93 @@
+//
+//  tx-track.h
+//  serialtest
+//
+//  Copyright (c) 2026 agent (agent@local)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Created on 16/10/2026 (agent)
+//
+
+#ifndef tx_track_h
+#define tx_track_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "histogram.h"
+
+#define TX_TRACK_DEPTH 64   // frames in flight, power of two
+
+// Transmit completion tracking without tcdrain(). Every frame written is
+// recorded with the running byte count at its end; the driver queue depth
+// (TIOCOUTQ) then tells how far the line got, so frames are retired, and
+// timestamped, as they leave. Bytes already in the UART or the USB bridge
+// FIFO are not visible to the driver, so "left" means "left the driver".
+typedef struct
+{
+    uint64_t end;           // running byte count at the end of the frame
+    uint64_t written;       // when it was written, ns
+} tx_record_t;
+
+// what the other threads get to see, behind a seqlock
+typedef struct
+{
+    uint32_t lock;
+    unsigned in_flight;
+    uint64_t completed;
+    histogram_t serialization;  // per frame, ns
+} tx_track_stats_t;
+
+typedef struct
+{
+    tx_record_t record[TX_TRACK_DEPTH];
+    unsigned head;
+    unsigned tail;
+    uint64_t written;       // bytes written so far
+    uint64_t retired;       // bytes of the frames retired so far
+    uint64_t line_free;     // when the line finished the last retired frame, ns
+    uint64_t poll_at;       // when to look at the queue again, 0 if idle
+    tx_track_stats_t stats;
+} tx_track_t;
+
+void
+tx_track_init (tx_track_t *t);
+
+void
+tx_track_write (tx_track_t *t, int fd, int baudrate, size_t len, uint64_t when);
+
+uint64_t
+tx_track_poll (tx_track_t *t, int fd, int baudrate);
+
+void
+tx_track_drain (tx_track_t *t, int fd, int baudrate);
+
+unsigned
+tx_track_in_flight (const tx_track_t *t);
+
+void
+tx_track_clear (tx_track_t *t);
+
+void
+tx_track_snapshot (const tx_track_t *t, tx_track_stats_t *stats);
+
+#endif /* tx_track_h */
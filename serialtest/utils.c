@@ -31,63 +31,98 @@
 #include <stdlib.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "utils.h"
 
-static int g_mode = PLAIN;
-static int serial_fd;
-
-void
-set_mode (op_mode_t mode)
+bool
+dump_frames (get_set_cmd_t operation, bool state)
 {
-    g_mode = mode;
+    static bool dump_frames_state = false;
+    
+    operation == SET_PARAMETER ? dump_frames_state = state : 0;
+    return dump_frames_state;
 }
 
-op_mode_t
-get_mode (void)
+
+uint8_t
+own_address (get_set_cmd_t operation, uint8_t address)
 {
-    return g_mode;
+    static uint8_t my_address = 10;
+    
+    operation == SET_PARAMETER ? my_address = address : 0;
+    return my_address;
 }
 
-void
-set_serial_fd (int fd)
+// Send frames with the extended header (64 bit timestamp).
+bool
+ext_header (get_set_cmd_t operation, bool state)
 {
-    serial_fd = fd;
+    static bool ext_header_state = false;
+    
+    operation == SET_PARAMETER ? ext_header_state = state : 0;
+    return ext_header_state;
 }
 
-int get_serial_fd (void)
+// Interval of the time series each port starts with, ms; 0 for none.
+uint32_t
+record_series (get_set_cmd_t operation, uint32_t interval_ms)
 {
-    return serial_fd;
+    static uint32_t record_series_ms = 0;
+    
+    operation == SET_PARAMETER ? record_series_ms = interval_ms : 0;
+    return record_series_ms;
 }
 
-bool
-dump_frames (get_set_cmd_t operation, bool state)
+//  @brief Monotonic time, in nanoseconds; never wraps in practice.
+
+uint64_t
+monotonic_ns (void)
 {
-    static bool dump_frames_state = false;
+    struct timespec tp;
     
-    operation == SET_PARAMETER ? dump_frames_state = state : 0;
-    return dump_frames_state;
+    clock_gettime (CLOCK_MONOTONIC, &tp);
+    return (uint64_t) tp.tv_sec * 1000000000ULL + tp.tv_nsec;
 }
 
 
-uint8_t
-own_address (get_set_cmd_t operation, uint8_t address)
+// CRC-16/CCITT (polynomial 0x1021, MSB first) lookup tables; crc_table[0] is
+// the classic byte-wise table, crc_table[k] advances a byte through k further
+// zero bytes, which is what the slicing-by-8 engine needs.
+static uint16_t crc_table[8][256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void
+crc_init_tables (void)
 {
-    static uint8_t my_address = 10;
+    int i, j;
     
-    operation == SET_PARAMETER ? my_address = address : 0;
-    return my_address;
+    for (i = 0; i < 256; i++)
+    {
+        uint16_t crc = (uint16_t) (i << 8);
+        for (j = 0; j < 8; j++)
+            crc = (crc & 0x8000) ? (crc << 1 ^ 0x1021) : (crc << 1);
+        crc_table[0][i] = crc;
+    }
+    for (i = 0; i < 256; i++)
+    {
+        for (j = 1; j < 8; j++)
+        {
+            uint16_t crc = crc_table[j - 1][i];
+            crc_table[j][i] = (crc << 8) ^ crc_table[0][crc >> 8];
+        }
+    }
 }
 
-
-//  @brief Computes the CRC-16 of the input string pointed to by buff.
+//  @brief Reference bit by bit CRC-16 engine.
 //  @param crc: initial crc value
 //  @param buff: a pointer to the buffer containing the data to be CRC-ized
 //  @param len: buffer length.
 //  @retval computed CRC-16 value.
 
 uint16_t
-calcCRC (uint16_t crc, uint8_t *buff, int len)
+crc16_bitwise (uint16_t crc, const uint8_t *buff, int len)
 {
     int i, j;
     
@@ -103,26 +138,70 @@ calcCRC (uint16_t crc, uint8_t *buff, int len)
     return crc;
 }
 
-bool
-cmd_data (int fd, bool state)
+//  @brief Table driven CRC-16 engine, one lookup per byte.
+
+uint16_t
+crc16_table (uint16_t crc, const uint8_t *buff, int len)
 {
-    bool result = true;
+    pthread_once (&crc_once, crc_init_tables);
     
-    if (state)
+    while (len-- > 0)
     {
-        // Assert Data Terminal Ready (DTR)
-        if (ioctl(fd, TIOCCDTR) == -1)
-        {
-            result = false;
-        }
+        crc = (crc << 8) ^ crc_table[0][(crc >> 8) ^ *buff++];
     }
-    else
+    return crc;
+}
+
+//  @brief Slicing-by-8 CRC-16 engine: eight independent lookups per 8 bytes,
+//      the tail is handled byte-wise.
+
+uint16_t
+crc16_slice8 (uint16_t crc, const uint8_t *buff, int len)
+{
+    pthread_once (&crc_once, crc_init_tables);
+    
+    while (len >= 8)
     {
-        // Clear Data Terminal Ready (DTR)
-        if (ioctl(fd, TIOCSDTR) == -1)
-        {
-            result = false;
-        }
+        crc = crc_table[7][buff[0] ^ (crc >> 8)] ^
+              crc_table[6][buff[1] ^ (crc & 0xff)] ^
+              crc_table[5][buff[2]] ^
+              crc_table[4][buff[3]] ^
+              crc_table[3][buff[4]] ^
+              crc_table[2][buff[5]] ^
+              crc_table[1][buff[6]] ^
+              crc_table[0][buff[7]];
+        buff += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+    {
+        crc = (crc << 8) ^ crc_table[0][(crc >> 8) ^ *buff++];
+    }
+    return crc;
+}
+
+//  @brief Computes the CRC-16 of the input string pointed to by buff.
+//  @param crc: initial crc value
+//  @param buff: a pointer to the buffer containing the data to be CRC-ized
+//  @param len: buffer length.
+//  @retval computed CRC-16 value.
+
+uint16_t
+calcCRC (uint16_t crc, uint8_t *buff, int len)
+{
+    // below 16 bytes the slicing setup does not pay off
+    if (len < 16)
+    {
+        return crc16_table (crc, buff, len);
     }
-    return result;
+    return crc16_slice8 (crc, buff, len);
+}
+
+bool
+cmd_data (int fd, bool state)
+{
+    int dtr = TIOCM_DTR;
+    
+    // data mode: DTR cleared; command mode: DTR asserted
+    return ioctl (fd, state ? TIOCMBIC : TIOCMBIS, &dtr) != -1;
 }
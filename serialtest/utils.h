@@ -29,6 +29,8 @@
 #define utils_h
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #define BCAST_ADDRESS 255
 
@@ -53,27 +55,33 @@ typedef struct __attribute__ ((packed))
     uint8_t extra;
 } red_header_t;
 
-void
-set_mode (op_mode_t mode);
-
-op_mode_t
-get_mode (void);
-
-void
-set_serial_fd (int fd);
-
-int
-get_serial_fd (void);
-
 bool
 dump_frames (get_set_cmd_t operation, bool state);
 
 uint8_t
 own_address (get_set_cmd_t operation, uint8_t address);
 
+bool
+ext_header (get_set_cmd_t operation, bool state);
+
+uint32_t
+record_series (get_set_cmd_t operation, uint32_t interval_ms);
+
+uint64_t
+monotonic_ns (void);
+
 uint16_t
 calcCRC (uint16_t crc, uint8_t *buff, int len);
 
+uint16_t
+crc16_bitwise (uint16_t crc, const uint8_t *buff, int len);
+
+uint16_t
+crc16_table (uint16_t crc, const uint8_t *buff, int len);
+
+uint16_t
+crc16_slice8 (uint16_t crc, const uint8_t *buff, int len);
+
 bool
 cmd_data (int fd, bool state);
 